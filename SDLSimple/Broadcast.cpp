@@ -0,0 +1,396 @@
+#include <iostream>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include "Broadcast.h"
+#include "Profiler.h"
+
+#ifndef _WINDOWS
+    #include <arpa/inet.h>
+    #include <fcntl.h>
+    #include <netinet/in.h>
+    #include <netinet/tcp.h>
+    #include <sys/socket.h>
+    #include <sys/uio.h>
+    #include <unistd.h>
+#endif
+
+#ifdef __linux__
+    #include <sys/epoll.h>
+#endif
+
+static_assert(SNAPSHOT_MAX_SIZE <= 255, "frame lengths are a single byte");
+
+constexpr int MAX_EVENTS          = 64, // per epoll_wait
+              MAX_FRAMES_PER_SEND = 64; // iovecs per sendmsg
+
+// ---- server ----
+
+#ifdef __linux__
+
+bool BroadcastServer::open(uint16_t port)
+{
+    close();
+
+    m_listener = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    m_epoll    = epoll_create1(0);
+
+    int reuse = 1;
+    sockaddr_in address = {};
+    address.sin_family      = AF_INET;
+    address.sin_port        = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK); // spectators on this machine only
+    socklen_t address_size  = sizeof(address);
+
+    epoll_event event = {};
+    event.events   = EPOLLIN;
+    event.data.ptr = nullptr; // the listener, viewers have their Viewer here
+
+    if (m_listener < 0 || m_epoll < 0 ||
+        setsockopt(m_listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) != 0 ||
+        bind(m_listener, (const sockaddr *) &address, sizeof(address)) != 0 ||
+        listen(m_listener, SOMAXCONN) != 0 ||
+        getsockname(m_listener, (sockaddr *) &address, &address_size) != 0 ||
+        epoll_ctl(m_epoll, EPOLL_CTL_ADD, m_listener, &event) != 0)
+    {
+        std::cout << "Unable to listen for viewers on port " << port << ": " << strerror(errno) << "\n";
+        close();
+        return false;
+    }
+
+    m_port = ntohs(address.sin_port);
+    return true;
+}
+
+void BroadcastServer::close()
+{
+    for (std::unique_ptr<Viewer> &viewer : m_viewers)
+    {
+        if (viewer->socket >= 0) ::close(viewer->socket);
+    }
+    m_viewers.clear();
+
+    if (m_listener >= 0) ::close(m_listener);
+    if (m_epoll >= 0) ::close(m_epoll);
+    m_listener = m_epoll = -1;
+    m_port = 0;
+    m_has_previous = false;
+}
+
+void BroadcastServer::accept_viewers()
+{
+    while (true)
+    {
+        int socket = accept4(m_listener, nullptr, nullptr, SOCK_NONBLOCK);
+        if (socket < 0) return; // EAGAIN once the backlog is empty, anything else we'll see again next time
+
+        // frames are a few bytes each and should go out as soon as they're made
+        int no_delay = 1;
+        setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, &no_delay, sizeof(no_delay));
+
+        std::unique_ptr<Viewer> viewer = std::make_unique<Viewer>();
+        viewer->socket = socket;
+
+        // viewers never send anything, reads only tell us they've gone
+        epoll_event event = {};
+        event.events   = EPOLLIN;
+        event.data.ptr = viewer.get();
+        if (epoll_ctl(m_epoll, EPOLL_CTL_ADD, socket, &event) != 0)
+        {
+            ::close(socket);
+            continue;
+        }
+
+        m_viewers.push_back(std::move(viewer));
+        m_stats.viewers_joined++;
+    }
+}
+
+void BroadcastServer::drop_viewer(Viewer &viewer)
+{
+    if (viewer.socket < 0) return;
+
+    // closing it takes it out of the epoll set too; the Viewer goes in remove_dropped_viewers(),
+    // as events already fetched can still point at it
+    ::close(viewer.socket);
+    viewer.socket = -1;
+    viewer.queue.clear();
+    m_stats.viewers_left++;
+}
+
+void BroadcastServer::remove_dropped_viewers()
+{
+    for (size_t i = 0; i < m_viewers.size(); )
+    {
+        if (m_viewers[i]->socket < 0) {
+            m_viewers[i] = std::move(m_viewers.back());
+            m_viewers.pop_back();
+        } else {
+            i++;
+        }
+    }
+}
+
+void BroadcastServer::watch_writes(Viewer &viewer, bool is_waiting)
+{
+    if (viewer.is_waiting_write == is_waiting) return;
+
+    epoll_event event = {};
+    event.events   = (uint32_t) EPOLLIN | (is_waiting ? (uint32_t) EPOLLOUT : 0u);
+    event.data.ptr = &viewer;
+    epoll_ctl(m_epoll, EPOLL_CTL_MOD, viewer.socket, &event);
+    viewer.is_waiting_write = is_waiting;
+}
+
+void BroadcastServer::send_queued(Viewer &viewer)
+{
+    while (!viewer.queue.empty())
+    {
+        // the frames go straight from the shared buffers, one gathered send for as many as there are
+        iovec  parts[MAX_FRAMES_PER_SEND];
+        size_t part_count = 0, total = 0;
+        for (const std::shared_ptr<const Frame> &frame : viewer.queue)
+        {
+            if (part_count == MAX_FRAMES_PER_SEND) break;
+
+            size_t offset = part_count == 0 ? viewer.front_offset : 0;
+            parts[part_count].iov_base = (void *) (frame->bytes + offset);
+            parts[part_count].iov_len  = frame->size - offset;
+            total += parts[part_count].iov_len;
+            part_count++;
+        }
+
+        msghdr message = {};
+        message.msg_iov    = parts;
+        message.msg_iovlen = part_count;
+
+        // MSG_NOSIGNAL: a viewer that's gone is an error here, not a SIGPIPE for the whole server
+        ssize_t sent = sendmsg(viewer.socket, &message, MSG_NOSIGNAL);
+        if (sent < 0)
+        {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            drop_viewer(viewer);
+            return;
+        }
+        m_stats.bytes_sent += (size_t) sent;
+
+        for (size_t left = (size_t) sent; left > 0; )
+        {
+            size_t front_left = viewer.queue.front()->size - viewer.front_offset;
+            if (left < front_left)
+            {
+                viewer.front_offset += left;
+                break;
+            }
+            left -= front_left;
+            viewer.front_offset = 0;
+            viewer.queue.pop_front();
+        }
+
+        if ((size_t) sent < total) break; // the kernel's buffer is full
+    }
+
+    // anything left goes out when epoll says there's room
+    watch_writes(viewer, !viewer.queue.empty());
+}
+
+void BroadcastServer::poll(int timeout_ms)
+{
+    if (m_epoll < 0) return;
+
+    epoll_event events[MAX_EVENTS];
+    int event_count = epoll_wait(m_epoll, events, MAX_EVENTS, timeout_ms);
+
+    for (int i = 0; i < event_count; i++)
+    {
+        if (events[i].data.ptr == nullptr)
+        {
+            accept_viewers();
+            continue;
+        }
+
+        Viewer &viewer = *(Viewer *) events[i].data.ptr;
+        if (viewer.socket < 0) continue; // dropped by an earlier event in this batch
+
+        if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+        {
+            unsigned char ignored[256];
+            ssize_t received = recv(viewer.socket, ignored, sizeof(ignored), 0);
+            if (received == 0 || (received < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+            {
+                drop_viewer(viewer);
+                continue;
+            }
+        }
+        if (events[i].events & EPOLLOUT) send_queued(viewer);
+    }
+
+    remove_dropped_viewers();
+}
+
+#else
+
+bool BroadcastServer::open(uint16_t port)
+{
+    (void) port;
+    std::cout << "Broadcasting needs epoll, so it's Linux only for now.\n";
+    return false;
+}
+
+void BroadcastServer::close() {}
+void BroadcastServer::accept_viewers() {}
+void BroadcastServer::drop_viewer(Viewer &viewer) { (void) viewer; }
+void BroadcastServer::remove_dropped_viewers() {}
+void BroadcastServer::watch_writes(Viewer &viewer, bool is_waiting) { (void) viewer; (void) is_waiting; }
+void BroadcastServer::send_queued(Viewer &viewer) { (void) viewer; }
+void BroadcastServer::poll(int timeout_ms) { (void) timeout_ms; }
+
+#endif
+
+std::shared_ptr<const BroadcastServer::Frame> BroadcastServer::make_frame(const QuantizedSim &state, const QuantizedSim *baseline)
+{
+    std::shared_ptr<Frame> frame = std::make_shared<Frame>();
+    size_t size = encode_snapshot(state, baseline, frame->bytes + 1);
+    frame->bytes[0] = (unsigned char) size;
+    frame->size     = 1 + size;
+    return frame;
+}
+
+void BroadcastServer::broadcast(const PongSim &state)
+{
+    PROFILE_ZONE("broadcast");
+    auto start = std::chrono::steady_clock::now();
+
+    QuantizedSim quantized = quantize_sim(state);
+
+    // one encode of each kind per call, however many viewers there are
+    std::shared_ptr<const Frame> delta, key;
+    if (m_has_previous) delta = make_frame(quantized, &m_previous);
+
+    for (std::unique_ptr<Viewer> &viewer : m_viewers)
+    {
+        // too far behind to be worth catching up frame by frame; a frame that's partly sent has
+        // to finish, or the stream loses its framing
+        if (viewer->queue.size() >= MAX_QUEUED_FRAMES)
+        {
+            viewer->queue.erase(viewer->queue.begin() + (viewer->front_offset > 0 ? 1 : 0), viewer->queue.end());
+            viewer->needs_key_frame = true;
+            m_stats.resyncs++;
+        }
+
+        if (viewer->needs_key_frame || !delta)
+        {
+            if (!key)
+            {
+                key = make_frame(quantized, nullptr);
+                m_stats.key_frames++;
+            }
+            viewer->queue.push_back(key);
+            viewer->needs_key_frame = false;
+        } else {
+            viewer->queue.push_back(delta);
+        }
+        m_stats.frames_queued++;
+
+        // one waiting on EPOLLOUT already has a full kernel buffer, poll() sends when there's room
+        if (!viewer->is_waiting_write) send_queued(*viewer);
+    }
+    remove_dropped_viewers();
+
+    m_previous     = quantized;
+    m_has_previous = true;
+    m_stats.frames++;
+
+    double elapsed_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    m_stats.broadcast_ms        += elapsed_ms;
+    m_stats.slowest_broadcast_ms = elapsed_ms > m_stats.slowest_broadcast_ms ? elapsed_ms : m_stats.slowest_broadcast_ms;
+}
+
+// ---- viewer ----
+
+bool BroadcastViewer::connect(const char *host, uint16_t port)
+{
+    close();
+#ifdef _WINDOWS
+    (void) host; (void) port;
+    std::cout << "Networking isn't available in Windows builds yet.\n";
+    return false;
+#else
+    m_socket = socket(AF_INET, SOCK_STREAM, 0);
+
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_port   = htons(port);
+
+    // a blocking connect, it's to this machine; non-blocking from then on
+    if (m_socket < 0 || inet_pton(AF_INET, host, &address.sin_addr) != 1 ||
+        ::connect(m_socket, (const sockaddr *) &address, sizeof(address)) != 0 ||
+        fcntl(m_socket, F_SETFL, fcntl(m_socket, F_GETFL) | O_NONBLOCK) != 0)
+    {
+        std::cout << "Unable to connect to the broadcast at " << host << ":" << port << ": " << strerror(errno) << "\n";
+        close();
+        return false;
+    }
+    return true;
+#endif
+}
+
+void BroadcastViewer::close()
+{
+#ifndef _WINDOWS
+    if (m_socket >= 0) ::close(m_socket);
+#endif
+    m_socket = -1;
+    m_pending.clear();
+}
+
+bool BroadcastViewer::receive()
+{
+#ifdef _WINDOWS
+    return false;
+#else
+    if (m_socket < 0) return false;
+
+    unsigned char buffer[4096];
+    bool is_hung_up = false;
+    while (true)
+    {
+        ssize_t received = recv(m_socket, buffer, sizeof(buffer), 0);
+        if (received > 0)
+        {
+            m_pending.insert(m_pending.end(), buffer, buffer + received);
+            m_bytes_received += (size_t) received;
+            continue;
+        }
+        if (received < 0 && errno == EINTR) continue;
+
+        // 0 is the server hanging up, but what it sent before that still counts; EAGAIN is
+        // simply having read everything
+        is_hung_up = received == 0 || (errno != EAGAIN && errno != EWOULDBLOCK);
+        break;
+    }
+
+    bool is_changed = false;
+    size_t at = 0;
+    while (at < m_pending.size() && m_pending.size() - at >= 1 + (size_t) m_pending[at])
+    {
+        size_t size = m_pending[at];
+        if (!decode_snapshot(m_pending.data() + at + 1, size, m_has_state ? &m_state : nullptr, m_state))
+        {
+            std::cout << "Received a snapshot that doesn't decode, disconnecting\n";
+            close();
+            return is_changed;
+        }
+
+        m_has_state = true;
+        m_frames_received++;
+        is_changed = true;
+        at += 1 + size;
+    }
+    m_pending.erase(m_pending.begin(), m_pending.begin() + at);
+
+    if (is_hung_up) close();
+    return is_changed;
+#endif
+}
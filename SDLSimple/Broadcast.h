@@ -0,0 +1,134 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <vector>
+#include "PongSim.h"
+#include "Snapshot.h"
+
+// Streaming a match to spectators over TCP on localhost. The server owns the authoritative
+// PongSim and calls broadcast() with it every few ticks; each call quantizes and encodes the
+// state once, as a delta against the previous broadcast, and every viewer's send queue takes a
+// reference to that one buffer rather than a copy. TCP keeps the frames in order, so a viewer
+// only ever needs the delta against what it decoded last; one that has just joined, or fallen
+// too far behind, gets a key frame instead (also encoded once, however many viewers need it).
+//
+// On the wire every frame is one length byte followed by the snapshot (see Snapshot.h).
+
+// accepts viewers and fans snapshots out to them from a single thread. The event loop is
+// epoll, so this only works on Linux; open() fails elsewhere.
+class BroadcastServer
+{
+public:
+    static constexpr size_t MAX_QUEUED_FRAMES = 120; // past this a viewer's backlog is dropped for a key frame
+
+    struct Stats
+    {
+        size_t frames         = 0; // broadcast() calls
+        size_t key_frames     = 0; // encoded for viewers that joined or fell behind
+        size_t frames_queued  = 0; // frames handed to viewers, so frames x viewers
+        size_t bytes_sent     = 0;
+        size_t viewers_joined = 0;
+        size_t viewers_left   = 0;
+        size_t resyncs        = 0;   // backlogs dropped for a key frame
+        double broadcast_ms   = 0.0; // in broadcast(): encoding, queueing and the sends it could make right away
+        double slowest_broadcast_ms = 0.0;
+    };
+
+    BroadcastServer() = default;
+    ~BroadcastServer() { close(); }
+
+    BroadcastServer(const BroadcastServer &) = delete;
+    BroadcastServer &operator=(const BroadcastServer &) = delete;
+
+    // listens on 127.0.0.1:port (0 for any free one, see get_port()); false with a message if not
+    bool open(uint16_t port);
+    void close();
+
+    // accepts new viewers, notices ones that left and sends whatever they have queued, waiting
+    // up to timeout_ms for any of that to happen
+    void poll(int timeout_ms);
+
+    void broadcast(const PongSim &state);
+
+    uint16_t get_port() const { return m_port; }
+    size_t get_viewer_count() const { return m_viewers.size(); }
+    const Stats &get_stats() const { return m_stats; }
+
+private:
+    struct Frame
+    {
+        size_t        size;
+        unsigned char bytes[1 + SNAPSHOT_MAX_SIZE];
+    };
+
+    struct Viewer
+    {
+        int    socket           = -1;    // -1 once dropped, until remove_dropped_viewers()
+        bool   needs_key_frame  = true;
+        bool   is_waiting_write = false; // registered for EPOLLOUT, the kernel's buffer was full
+        size_t front_offset     = 0;     // bytes of the front frame already sent
+        std::deque<std::shared_ptr<const Frame>> queue;
+    };
+
+    std::shared_ptr<const Frame> make_frame(const QuantizedSim &state, const QuantizedSim *baseline);
+
+    void accept_viewers();
+    void send_queued(Viewer &viewer);
+    void watch_writes(Viewer &viewer, bool is_waiting);
+    void drop_viewer(Viewer &viewer);
+    void remove_dropped_viewers();
+
+    int      m_listener = -1;
+    int      m_epoll    = -1;
+    uint16_t m_port     = 0;
+
+    // viewer pointers go into epoll events, so they have to stay put as others come and go
+    std::vector<std::unique_ptr<Viewer>> m_viewers;
+
+    QuantizedSim m_previous;
+    bool         m_has_previous = false;
+
+    Stats m_stats;
+};
+
+// the receiving end: connects to a BroadcastServer and keeps the latest state it sent. Plain
+// non-blocking recv(), no epoll, one of these per viewer.
+class BroadcastViewer
+{
+public:
+    BroadcastViewer() = default;
+    ~BroadcastViewer() { close(); }
+
+    BroadcastViewer(const BroadcastViewer &) = delete;
+    BroadcastViewer &operator=(const BroadcastViewer &) = delete;
+
+    // false with a message if the server can't be reached
+    bool connect(const char *host, uint16_t port);
+    void close();
+
+    // decodes everything that has arrived; true if the state changed
+    bool receive();
+
+    // still connected and nothing malformed has come in
+    bool is_connected() const { return m_socket >= 0; }
+
+    bool has_state() const { return m_has_state; }
+    const QuantizedSim &get_state() const { return m_state; }
+
+    size_t get_frames_received() const { return m_frames_received; }
+    size_t get_bytes_received()  const { return m_bytes_received; }
+
+private:
+    int m_socket = -1;
+
+    std::vector<unsigned char> m_pending; // the start of a frame that hasn't fully arrived
+
+    QuantizedSim m_state;
+    bool         m_has_state = false;
+
+    size_t m_frames_received = 0;
+    size_t m_bytes_received  = 0;
+};
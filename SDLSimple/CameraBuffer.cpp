@@ -0,0 +1,45 @@
+#define GL_SILENCE_DEPRECATION
+
+#include <cstring>
+#include "CameraBuffer.h"
+#include "GLSupport.h"
+
+bool CameraBuffer::is_supported()
+{
+    // the shaders are GLSL 1.10, which only gets uniform blocks through the extension
+    return gl_has_extension("GL_ARB_uniform_buffer_object");
+}
+
+void CameraBuffer::initialise()
+{
+    glGenBuffers(1, &m_buffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(Block), NULL, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    glBindBufferBase(GL_UNIFORM_BUFFER, BINDING_POINT, m_buffer);
+}
+
+void CameraBuffer::cleanup()
+{
+    glDeleteBuffers(1, &m_buffer);
+    m_buffer = 0;
+}
+
+void CameraBuffer::update(const glm::mat4 &view_matrix, const glm::mat4 &projection_matrix, float time)
+{
+    Block block;
+    memcpy(block.view_matrix, &view_matrix[0][0], sizeof(block.view_matrix));
+    memcpy(block.projection_matrix, &projection_matrix[0][0], sizeof(block.projection_matrix));
+    block.time = time;
+    block.padding[0] = block.padding[1] = block.padding[2] = 0.0f;
+
+    glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(Block), &block);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+bool CameraBuffer::attach(ShaderProgram &program) const
+{
+    return program.bind_uniform_block("Camera", BINDING_POINT);
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "glm/mat4x4.hpp"
+#include "ShaderProgram.h"
+
+// Per-frame camera state in one std140 uniform block ("Camera", see the shaders) that every
+// program reads from the same binding point, so it's written once a frame instead of once per
+// program. Needs GLSL 3.30 shaders or GL_ARB_uniform_buffer_object; otherwise programs are loaded
+// without CAMERA_BLOCK_PREAMBLE and keep their plain view/projection uniforms.
+class CameraBuffer
+{
+public:
+    static constexpr GLuint BINDING_POINT = 0;
+
+    // true if the GLSL 1.10 shaders can use uniform blocks on the current context
+    static bool is_supported();
+
+    void initialise();
+    void cleanup();
+
+    // uploads the whole block, call once per frame before drawing
+    void update(const glm::mat4 &view_matrix, const glm::mat4 &projection_matrix, float time);
+
+    // points `program`'s Camera block at this buffer, false if the program doesn't have one
+    bool attach(ShaderProgram &program) const;
+
+private:
+    // mirrors the GLSL block under std140: mat4s are four vec4 columns, and the block is padded
+    // out to a multiple of 16 bytes
+    struct Block
+    {
+        float view_matrix[16];
+        float projection_matrix[16];
+        float time;
+        float padding[3];
+    };
+    static_assert(sizeof(Block) == 144, "the Camera block is 144 bytes under std140");
+
+    GLuint m_buffer = 0;
+};
+
+// prepended to both shader stages so they declare the Camera block instead of loose uniforms
+constexpr char CAMERA_BLOCK_PREAMBLE[] = "#extension GL_ARB_uniform_buffer_object : enable\n"
+                                         "#define CAMERA_BLOCK 1\n";
+
+// the same for the GLSL 3.30 shaders, which have uniform blocks without the extension
+constexpr char CAMERA_BLOCK_330_PREAMBLE[] = "#define CAMERA_BLOCK 1\n";
@@ -0,0 +1,195 @@
+// let glm's platform detection look at the compiler's target flags (-mavx2, -msse2, ...)
+#define GLM_FORCE_INTRINSICS
+#include "glm/simd/platform.h"
+
+#include <cstring>
+#include "CollisionKernel.h"
+#include "PongRules.h"
+#include "SweptCollision.h"
+
+#if GLM_ARCH & GLM_ARCH_AVX2_BIT
+    #define COLLISION_KERNEL_AVX2 1
+#elif GLM_ARCH & GLM_ARCH_SSE2_BIT
+    #define COLLISION_KERNEL_SSE2 1
+#endif
+
+void resolve_collisions_scalar(const CollisionLanes &lanes, size_t begin, size_t end, float delta_time)
+{
+    float       *bx  = lanes.ball_x,     *by = lanes.ball_y;
+    float       *vx  = lanes.velocity_x, *vy = lanes.velocity_y;
+    const float *spd = lanes.ball_speed;
+    const float *c1  = lanes.cat1_y,     *c2 = lanes.cat2_y;
+    uint8_t     *game_over = lanes.is_game_over;
+
+    for (size_t i = begin; i < end; i++)
+    {
+        if (game_over[i]) continue;
+
+        // the paddles start at y = 0, so their offsets are also their centres
+        if (sweep_ball(bx[i], by[i], vx[i], vy[i], spd[i], c1[i], c2[i], delta_time)) game_over[i] = true;
+    }
+}
+
+// The SIMD paths are a broadphase: every lane moves in a straight line, and only lanes whose
+// straight-line move would reach a wall or cross a paddle face are handed to sweep_ball().
+// Most balls hit nothing on most steps, so most of the work stays in vector registers.
+// A lane that hits nothing gets exactly the same arithmetic sweep_ball() would have used.
+
+#if COLLISION_KERNEL_AVX2
+
+const char *collision_kernel_name() { return "AVX2"; }
+
+void resolve_collisions(const CollisionLanes &lanes, size_t begin, size_t end, float delta_time)
+{
+    constexpr size_t LANES = 8;
+
+    float       *bx  = lanes.ball_x,     *by = lanes.ball_y;
+    float       *vx  = lanes.velocity_x, *vy = lanes.velocity_y;
+    const float *spd = lanes.ball_speed;
+    const float *c1  = lanes.cat1_y,     *c2 = lanes.cat2_y;
+    uint8_t     *game_over = lanes.is_game_over;
+
+    const __m256 dt         = _mm256_set1_ps(delta_time),
+                 ball_half  = _mm256_set1_ps(BALL_HALF_SIZE),
+                 top_limit  = _mm256_set1_ps(BALL_TOP_LIMIT),
+                 bot_limit  = _mm256_set1_ps(BALL_BOTTOM_LIMIT),
+                 cat1_limit = _mm256_set1_ps(CAT1_CONTACT_X),
+                 cat2_limit = _mm256_set1_ps(CAT2_CONTACT_X),
+                 right      = _mm256_set1_ps(COURT_RIGHT),
+                 left       = _mm256_set1_ps(COURT_LEFT);
+
+    size_t i = begin;
+    for (; i + LANES <= end; i += LANES)
+    {
+        // widen the 8 game-over bytes into a lane mask of finished matches
+        __m128i over_bytes = _mm_loadl_epi64((const __m128i *) (game_over + i));
+        __m256  over = _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_cvtepu8_epi32(over_bytes), _mm256_setzero_si256()));
+        if (_mm256_movemask_ps(over) == 0xFF) continue;
+
+        __m256 x = _mm256_loadu_ps(bx + i), y = _mm256_loadu_ps(by + i);
+        __m256 s = _mm256_loadu_ps(spd + i);
+
+        __m256 end_x = _mm256_add_ps(x, _mm256_mul_ps(_mm256_mul_ps(_mm256_loadu_ps(vx + i), s), dt)),
+               end_y = _mm256_add_ps(y, _mm256_mul_ps(_mm256_mul_ps(_mm256_loadu_ps(vy + i), s), dt));
+
+        // would the straight-line move touch a wall or cross either paddle face?
+        __m256 wall  = _mm256_or_ps(_mm256_cmp_ps(end_y, top_limit, _CMP_GT_OQ),
+                                    _mm256_cmp_ps(end_y, bot_limit, _CMP_LT_OQ));
+        __m256 face1 = _mm256_and_ps(_mm256_cmp_ps(x, cat1_limit, _CMP_GE_OQ), _mm256_cmp_ps(end_x, cat1_limit, _CMP_LT_OQ));
+        __m256 face2 = _mm256_and_ps(_mm256_cmp_ps(x, cat2_limit, _CMP_LE_OQ), _mm256_cmp_ps(end_x, cat2_limit, _CMP_GT_OQ));
+        __m256 busy  = _mm256_andnot_ps(over, _mm256_or_ps(wall, _mm256_or_ps(face1, face2)));
+        __m256 clear = _mm256_andnot_ps(over, _mm256_andnot_ps(busy, _mm256_castsi256_ps(_mm256_set1_epi32(-1))));
+
+        // lanes with nothing in the way take the straight-line move
+        _mm256_storeu_ps(bx + i, _mm256_blendv_ps(x, end_x, clear));
+        _mm256_storeu_ps(by + i, _mm256_blendv_ps(y, end_y, clear));
+
+        __m256 out = _mm256_or_ps(_mm256_cmp_ps(_mm256_add_ps(end_x, ball_half), right, _CMP_GT_OQ),
+                                  _mm256_cmp_ps(_mm256_sub_ps(end_x, ball_half), left, _CMP_LT_OQ));
+
+        int goals = _mm256_movemask_ps(_mm256_and_ps(clear, out));
+        for (size_t lane = 0; goals != 0; lane++, goals >>= 1)
+        {
+            if (goals & 1) game_over[i + lane] = true;
+        }
+
+        int impacts = _mm256_movemask_ps(busy);
+        for (size_t lane = 0; impacts != 0; lane++, impacts >>= 1)
+        {
+            size_t m = i + lane;
+            if ((impacts & 1) && sweep_ball(bx[m], by[m], vx[m], vy[m], spd[m], c1[m], c2[m], delta_time)) {
+                game_over[m] = true;
+            }
+        }
+    }
+
+    resolve_collisions_scalar(lanes, i, end, delta_time);
+}
+
+#elif COLLISION_KERNEL_SSE2
+
+const char *collision_kernel_name() { return "SSE2"; }
+
+// SSE2 has no blendv, so select with and/andnot/or
+static inline __m128 select_ps(__m128 mask, __m128 if_true, __m128 if_false)
+{
+    return _mm_or_ps(_mm_and_ps(mask, if_true), _mm_andnot_ps(mask, if_false));
+}
+
+void resolve_collisions(const CollisionLanes &lanes, size_t begin, size_t end, float delta_time)
+{
+    constexpr size_t LANES = 4;
+
+    float       *bx  = lanes.ball_x,     *by = lanes.ball_y;
+    float       *vx  = lanes.velocity_x, *vy = lanes.velocity_y;
+    const float *spd = lanes.ball_speed;
+    const float *c1  = lanes.cat1_y,     *c2 = lanes.cat2_y;
+    uint8_t     *game_over = lanes.is_game_over;
+
+    const __m128 dt         = _mm_set1_ps(delta_time),
+                 ball_half  = _mm_set1_ps(BALL_HALF_SIZE),
+                 top_limit  = _mm_set1_ps(BALL_TOP_LIMIT),
+                 bot_limit  = _mm_set1_ps(BALL_BOTTOM_LIMIT),
+                 cat1_limit = _mm_set1_ps(CAT1_CONTACT_X),
+                 cat2_limit = _mm_set1_ps(CAT2_CONTACT_X),
+                 right      = _mm_set1_ps(COURT_RIGHT),
+                 left       = _mm_set1_ps(COURT_LEFT);
+
+    size_t i = begin;
+    for (; i + LANES <= end; i += LANES)
+    {
+        // widen the 4 game-over bytes into a lane mask of finished matches
+        int32_t over_word;
+        memcpy(&over_word, game_over + i, sizeof(over_word));
+        __m128i zero = _mm_setzero_si128();
+        __m128i wide = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(over_word), zero), zero);
+        __m128  over = _mm_castsi128_ps(_mm_cmpgt_epi32(wide, zero));
+        if (_mm_movemask_ps(over) == 0xF) continue;
+
+        __m128 x = _mm_loadu_ps(bx + i), y = _mm_loadu_ps(by + i);
+        __m128 s = _mm_loadu_ps(spd + i);
+
+        __m128 end_x = _mm_add_ps(x, _mm_mul_ps(_mm_mul_ps(_mm_loadu_ps(vx + i), s), dt)),
+               end_y = _mm_add_ps(y, _mm_mul_ps(_mm_mul_ps(_mm_loadu_ps(vy + i), s), dt));
+
+        __m128 wall  = _mm_or_ps(_mm_cmpgt_ps(end_y, top_limit), _mm_cmplt_ps(end_y, bot_limit));
+        __m128 face1 = _mm_and_ps(_mm_cmpge_ps(x, cat1_limit), _mm_cmplt_ps(end_x, cat1_limit));
+        __m128 face2 = _mm_and_ps(_mm_cmple_ps(x, cat2_limit), _mm_cmpgt_ps(end_x, cat2_limit));
+        __m128 busy  = _mm_andnot_ps(over, _mm_or_ps(wall, _mm_or_ps(face1, face2)));
+        __m128 clear = _mm_andnot_ps(over, _mm_andnot_ps(busy, _mm_castsi128_ps(_mm_set1_epi32(-1))));
+
+        _mm_storeu_ps(bx + i, select_ps(clear, end_x, x));
+        _mm_storeu_ps(by + i, select_ps(clear, end_y, y));
+
+        __m128 out = _mm_or_ps(_mm_cmpgt_ps(_mm_add_ps(end_x, ball_half), right),
+                               _mm_cmplt_ps(_mm_sub_ps(end_x, ball_half), left));
+
+        int goals = _mm_movemask_ps(_mm_and_ps(clear, out));
+        for (size_t lane = 0; goals != 0; lane++, goals >>= 1)
+        {
+            if (goals & 1) game_over[i + lane] = true;
+        }
+
+        int impacts = _mm_movemask_ps(busy);
+        for (size_t lane = 0; impacts != 0; lane++, impacts >>= 1)
+        {
+            size_t m = i + lane;
+            if ((impacts & 1) && sweep_ball(bx[m], by[m], vx[m], vy[m], spd[m], c1[m], c2[m], delta_time)) {
+                game_over[m] = true;
+            }
+        }
+    }
+
+    resolve_collisions_scalar(lanes, i, end, delta_time);
+}
+
+#else
+
+const char *collision_kernel_name() { return "scalar"; }
+
+void resolve_collisions(const CollisionLanes &lanes, size_t begin, size_t end, float delta_time)
+{
+    resolve_collisions_scalar(lanes, begin, end, delta_time);
+}
+
+#endif
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// the MatchBatch arrays the kernel touches. Deliberately glm-free: CollisionKernel.cpp turns
+// on glm's intrinsics detection, which must not leak into the glm types used everywhere else.
+struct CollisionLanes
+{
+    float       *ball_x, *ball_y, *velocity_x, *velocity_y;
+    const float *ball_speed, *cat1_y, *cat2_y;
+    uint8_t     *is_game_over;
+};
+
+// moves every ball still in play in [begin, end) by delta_time, bouncing it off paddles and
+// walls with sweep_ball(), and flags matches whose ball left the court. Same rules as step().
+// Uses AVX2 (8 matches at a time) or SSE2 (4 at a time) when glm/simd/platform.h detects them.
+void resolve_collisions(const CollisionLanes &lanes, size_t begin, size_t end, float delta_time);
+
+// one match at a time, always available; the SIMD paths use it for leftover matches
+void resolve_collisions_scalar(const CollisionLanes &lanes, size_t begin, size_t end, float delta_time);
+
+// "AVX2", "SSE2" or "scalar", depending on what resolve_collisions() was compiled for
+const char *collision_kernel_name();
@@ -0,0 +1,52 @@
+#include <algorithm>
+#include "FrameStats.h"
+
+void FrameStats::record(float cpu_ms, float swap_ms, float simulation_ms, int simulation_steps)
+{
+    size_t slot = m_frame_count % WINDOW;
+    m_samples[CPU_FRAME][slot]  = cpu_ms;
+    m_samples[SWAP][slot]       = swap_ms;
+    m_samples[SIMULATION][slot] = simulation_ms;
+
+    if (m_csv.is_open())
+    {
+        m_csv << m_frame_count << ',' << cpu_ms << ',' << swap_ms << ',' << simulation_ms << ','
+              << simulation_steps << '\n';
+    }
+
+    m_frame_count++;
+}
+
+FrameStats::Percentiles FrameStats::get_percentiles(Series series) const
+{
+    size_t count = std::min(m_frame_count, WINDOW);
+    if (count == 0) return Percentiles();
+
+    float sorted[WINDOW];
+    std::copy(m_samples[series], m_samples[series] + count, sorted);
+    std::sort(sorted, sorted + count);
+
+    // nearest rank, so p99 of a full window is the third slowest frame
+    auto rank = [&](float fraction) { return sorted[std::min(count - 1, (size_t) (fraction * count))]; };
+
+    Percentiles percentiles;
+    percentiles.p50 = rank(0.50f);
+    percentiles.p95 = rank(0.95f);
+    percentiles.p99 = rank(0.99f);
+    percentiles.max = sorted[count - 1];
+    return percentiles;
+}
+
+bool FrameStats::open_csv(const char *filepath)
+{
+    m_csv.open(filepath, std::ios::trunc);
+    if (!m_csv) return false;
+
+    m_csv << "frame,cpu_ms,swap_ms,sim_ms,sim_steps\n";
+    return true;
+}
+
+void FrameStats::close_csv()
+{
+    if (m_csv.is_open()) m_csv.close();
+}
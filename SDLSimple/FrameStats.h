@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <fstream>
+
+// Rolling frame-time percentiles over the last WINDOW frames, split into CPU time, time spent in
+// the buffer swap and time spent stepping the simulation. Every frame can also be appended to a
+// CSV file so runs can be compared between commits.
+class FrameStats
+{
+public:
+    static constexpr size_t WINDOW = 240; // about four seconds at 60 fps
+
+    enum Series { CPU_FRAME, SWAP, SIMULATION, SERIES_COUNT };
+
+    struct Percentiles
+    {
+        float p50 = 0.0f, p95 = 0.0f, p99 = 0.0f, max = 0.0f;
+    };
+
+    // all times in milliseconds; cpu_ms is the whole frame minus the swap
+    void record(float cpu_ms, float swap_ms, float simulation_ms, int simulation_steps);
+
+    // over the frames currently in the window
+    Percentiles get_percentiles(Series series) const;
+
+    // starts streaming one row per recorded frame to `filepath`, false if it can't be opened
+    bool open_csv(const char *filepath);
+    void close_csv();
+
+    size_t get_frame_count() const { return m_frame_count; }
+
+private:
+    float  m_samples[SERIES_COUNT][WINDOW] = {};
+    size_t m_frame_count = 0;
+
+    std::ofstream m_csv;
+};
+
+constexpr const char *FRAME_STATS_SERIES_NAMES[FrameStats::SERIES_COUNT] = { "cpu", "swap", "sim" };
@@ -0,0 +1,42 @@
+#define GL_SILENCE_DEPRECATION
+
+#include <cstdio>
+#include <cstring>
+#include "GLSupport.h"
+
+bool gl_version_at_least(int major, int minor)
+{
+    const char *version = (const char *) glGetString(GL_VERSION);
+    int context_major = 0, context_minor = 0;
+    if (version == nullptr || sscanf(version, "%d.%d", &context_major, &context_minor) != 2) return false;
+    return context_major > major || (context_major == major && context_minor >= minor);
+}
+
+bool gl_has_extension(const char *name)
+{
+    // core profiles drop the single GL_EXTENSIONS string, so ask for them one at a time from 3.0 on
+    if (gl_version_at_least(3, 0))
+    {
+        GLint count = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+        for (GLint i = 0; i < count; i++)
+        {
+            const char *extension = (const char *) glGetStringi(GL_EXTENSIONS, i);
+            if (extension != nullptr && strcmp(extension, name) == 0) return true;
+        }
+        return false;
+    }
+
+    return extension_list_contains((const char *) glGetString(GL_EXTENSIONS), name);
+}
+
+bool extension_list_contains(const char *extensions, const char *name)
+{
+    size_t length = strlen(name);
+    for (const char *at = extensions; at != nullptr && (at = strstr(at, name)) != nullptr; at += length)
+    {
+        // a whole word, not the start of a longer extension's name
+        if ((at == extensions || at[-1] == ' ') && (at[length] == ' ' || at[length] == '\0')) return true;
+    }
+    return false;
+}
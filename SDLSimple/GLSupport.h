@@ -0,0 +1,24 @@
+#pragma once
+
+#ifdef _WINDOWS
+    #include <GL/glew.h>
+#endif
+#define GL_GLEXT_PROTOTYPES 1
+#if __has_include(<SDL_opengl.h>)
+    #include <SDL_opengl.h>
+#else
+    // no SDL (the benchmarks and the offscreen renderer don't need it), same declarations straight from the system
+    #include <GL/gl.h>
+    #include <GL/glext.h>
+#endif
+
+// what the current context can do; only valid once a context is current
+
+// true if the context's GL_VERSION is at least major.minor
+bool gl_version_at_least(int major, int minor);
+
+// true if the driver lists `name` (e.g. "GL_ARB_uniform_buffer_object") as an extension
+bool gl_has_extension(const char *name);
+
+// whether a space separated extension string (GL, EGL, ...) has `name` as one of its entries
+bool extension_list_contains(const char *extensions, const char *name);
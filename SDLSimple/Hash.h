@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+constexpr uint64_t FNV_OFFSET_BASIS = 14695981039346656037ull,
+                   FNV_PRIME        = 1099511628211ull;
+
+// FNV-1a, only for telling whether cached data still matches what it was built from; pass the
+// previous result as `hash` to keep hashing more data into it
+inline uint64_t hash_bytes(const void *data, size_t size, uint64_t hash = FNV_OFFSET_BASIS)
+{
+    const unsigned char *bytes = (const unsigned char *) data;
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
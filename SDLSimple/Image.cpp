@@ -0,0 +1,195 @@
+// let glm's platform detection look at the compiler's target flags, same as the collision kernel
+#define GLM_FORCE_INTRINSICS
+#include "glm/simd/platform.h"
+
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include "Image.h"
+#include "stb_image.h"
+
+#if GLM_ARCH & GLM_ARCH_SSE2_BIT
+    #define IMAGE_RESAMPLE_SSE2 1
+#endif
+
+static void take_pixels(unsigned char *pixels, int width, int height, Image &image)
+{
+    image = Image();
+    image.width  = width;
+    image.height = height;
+    image.pixels.assign(pixels, pixels + (size_t) width * height * IMAGE_CHANNELS);
+
+    stbi_image_free(pixels);
+}
+
+bool load_image(const char *filepath, Image &image)
+{
+    int width, height, number_of_components;
+    unsigned char *pixels = stbi_load(filepath, &width, &height, &number_of_components, STBI_rgb_alpha);
+
+    if (pixels == NULL)
+    {
+        std::cout << "Unable to load image " << filepath << ". Make sure the path is correct.\n";
+        image = Image();
+        return false;
+    }
+
+    take_pixels(pixels, width, height, image);
+    return true;
+}
+
+bool decode_image(const unsigned char *data, size_t size, Image &image)
+{
+    int width, height, number_of_components;
+    unsigned char *pixels = stbi_load_from_memory(data, (int) size, &width, &height, &number_of_components, STBI_rgb_alpha);
+
+    if (pixels == NULL)
+    {
+        image = Image();
+        return false;
+    }
+
+    take_pixels(pixels, width, height, image);
+    return true;
+}
+
+// how much each source pixel along one axis contributes to each destination pixel, for an
+// area-weighted box filter: destination pixel i covers source span [i * ratio, (i + 1) * ratio)
+struct Tap
+{
+    int   source;
+    float weight;
+};
+
+static void build_taps(int source_size, int target_size, std::vector<int> &first_tap, std::vector<Tap> &taps)
+{
+    float ratio = (float) source_size / target_size;
+    first_tap.assign(target_size + 1, 0);
+    taps.clear();
+
+    for (int i = 0; i < target_size; i++)
+    {
+        float start = i * ratio, end = (i + 1) * ratio;
+        first_tap[i] = (int) taps.size();
+
+        for (int s = (int) start; s < source_size && s < end; s++)
+        {
+            float covered = std::min(end, (float) (s + 1)) - std::max(start, (float) s);
+            if (covered > 0.0f) taps.push_back({ s, covered / ratio });
+        }
+    }
+    first_tap[target_size] = (int) taps.size();
+}
+
+
+Image downscale_image(const Image &source, int target_width, int target_height)
+{
+    std::vector<int> first_x, first_y;
+    std::vector<Tap> taps_x, taps_y;
+    build_taps(source.width, target_width, first_x, taps_x);
+    build_taps(source.height, target_height, first_y, taps_y);
+
+    // premultiply alpha first so the transparent pixels' colour doesn't bleed into the edges
+    size_t source_pixels = (size_t) source.width * source.height;
+    std::vector<float> premultiplied(source_pixels * IMAGE_CHANNELS);
+    for (size_t p = 0; p < source_pixels; p++)
+    {
+        const unsigned char *in = source.data() + p * IMAGE_CHANNELS;
+#if IMAGE_RESAMPLE_SSE2
+        int32_t packed;
+        memcpy(&packed, in, sizeof(packed));
+        __m128i zero  = _mm_setzero_si128();
+        __m128  pixel = _mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(packed), zero), zero));
+        __m128  alpha = _mm_set_ps(1.0f, in[3] / 255.0f, in[3] / 255.0f, in[3] / 255.0f);
+        _mm_storeu_ps(&premultiplied[p * 4], _mm_mul_ps(pixel, alpha));
+#else
+        float alpha = in[3] / 255.0f;
+        premultiplied[p * 4 + 0] = in[0] * alpha;
+        premultiplied[p * 4 + 1] = in[1] * alpha;
+        premultiplied[p * 4 + 2] = in[2] * alpha;
+        premultiplied[p * 4 + 3] = in[3];
+#endif
+    }
+
+    // horizontal pass: every source row shrinks to target_width pixels
+    std::vector<float> rows((size_t) target_width * source.height * IMAGE_CHANNELS);
+    for (int y = 0; y < source.height; y++)
+    {
+        const float *in  = &premultiplied[(size_t) y * source.width * IMAGE_CHANNELS];
+        float       *out = &rows[(size_t) y * target_width * IMAGE_CHANNELS];
+
+        for (int x = 0; x < target_width; x++)
+        {
+            // one RGBA pixel per register, so each tap is a single multiply-add over all four channels
+#if IMAGE_RESAMPLE_SSE2
+            __m128 sum = _mm_setzero_ps();
+            for (int t = first_x[x]; t < first_x[x + 1]; t++)
+            {
+                sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(in + taps_x[t].source * 4), _mm_set1_ps(taps_x[t].weight)));
+            }
+            _mm_storeu_ps(out + x * 4, sum);
+#else
+            float sum[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+            for (int t = first_x[x]; t < first_x[x + 1]; t++)
+            {
+                for (int c = 0; c < 4; c++) sum[c] += in[taps_x[t].source * 4 + c] * taps_x[t].weight;
+            }
+            memcpy(out + x * 4, sum, sizeof(sum));
+#endif
+        }
+    }
+
+    // vertical pass: blend the shrunk rows together, then undo the premultiply
+    Image result;
+    result.width  = target_width;
+    result.height = target_height;
+    result.pixels.resize((size_t) target_width * target_height * IMAGE_CHANNELS);
+
+    std::vector<float> line((size_t) target_width * IMAGE_CHANNELS);
+    for (int y = 0; y < target_height; y++)
+    {
+        std::fill(line.begin(), line.end(), 0.0f);
+
+        for (int t = first_y[y]; t < first_y[y + 1]; t++)
+        {
+            const float *in = &rows[(size_t) taps_y[t].source * target_width * IMAGE_CHANNELS];
+#if IMAGE_RESAMPLE_SSE2
+            __m128 weight = _mm_set1_ps(taps_y[t].weight);
+            for (size_t i = 0; i < line.size(); i += 4)
+            {
+                _mm_storeu_ps(&line[i], _mm_add_ps(_mm_loadu_ps(&line[i]), _mm_mul_ps(_mm_loadu_ps(in + i), weight)));
+            }
+#else
+            for (size_t i = 0; i < line.size(); i++) line[i] += in[i] * taps_y[t].weight;
+#endif
+        }
+
+        unsigned char *out = &result.pixels[(size_t) y * target_width * IMAGE_CHANNELS];
+        for (int x = 0; x < target_width; x++)
+        {
+            const float *pixel = &line[x * 4];
+            float alpha = pixel[3];
+            float unpremultiply = alpha > 0.0f ? 255.0f / alpha : 0.0f;
+
+            out[x * 4 + 0] = (unsigned char) std::min(255.0f, pixel[0] * unpremultiply + 0.5f);
+            out[x * 4 + 1] = (unsigned char) std::min(255.0f, pixel[1] * unpremultiply + 0.5f);
+            out[x * 4 + 2] = (unsigned char) std::min(255.0f, pixel[2] * unpremultiply + 0.5f);
+            out[x * 4 + 3] = (unsigned char) std::min(255.0f, alpha + 0.5f);
+        }
+    }
+
+    return result;
+}
+
+size_t fit_image(Image &image, int max_width, int max_height)
+{
+    int target_width  = std::max(1, std::min(image.width, max_width)),
+        target_height = std::max(1, std::min(image.height, max_height));
+
+    if (image.empty() || (target_width == image.width && target_height == image.height)) return 0;
+
+    size_t original_bytes = image.size();
+    image = downscale_image(image, target_width, target_height);
+    return original_bytes - image.size();
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+constexpr int IMAGE_CHANNELS = 4;
+
+// decoded RGBA pixels, rows top to bottom, the way stbi_load hands them to us
+struct Image
+{
+    int width  = 0;
+    int height = 0;
+    std::vector<unsigned char> pixels;
+
+    // set instead of `pixels` when they're read straight out of a memory-mapped file
+    std::shared_ptr<const unsigned char> mapped_pixels;
+
+    const unsigned char *data() const { return mapped_pixels ? mapped_pixels.get() : pixels.data(); }
+    bool empty() const { return !mapped_pixels && pixels.empty(); }
+    size_t size() const { return empty() ? 0 : (size_t) width * height * IMAGE_CHANNELS; }
+};
+
+// false (and an empty image) if the file couldn't be read or decoded
+bool load_image(const char *filepath, Image &image);
+
+// same, for an encoded PNG (or anything else stb_image reads) that's already in memory
+bool decode_image(const unsigned char *data, size_t size, Image &image);
+
+// area-weighted box filter down to exactly target_width x target_height (both no bigger than the source)
+Image downscale_image(const Image &source, int target_width, int target_height);
+
+// shrinks the image in place if it's bigger than max_width x max_height on either axis (it is never
+// scaled up), returns how many bytes of pixels that saved
+size_t fit_image(Image &image, int max_width, int max_height);
@@ -0,0 +1,132 @@
+#include <iostream>
+#include <fstream>
+#include <cstring>
+#include "InputRecording.h"
+
+// the changes follow right after it, five bytes each (tick, then bits) with no padding
+struct RecordingHeader
+{
+    char     magic[4];
+    uint32_t version;
+    float    fixed_timestep;
+    uint32_t change_count;
+    uint64_t tick_count;
+    uint64_t final_hash;
+};
+
+constexpr char RECORDING_MAGIC[4] = { 'P', 'I', 'N', 'P' };
+constexpr size_t CHANGE_SIZE = sizeof(uint32_t) + sizeof(uint8_t);
+
+uint8_t pack_inputs(const PongInputs &inputs)
+{
+    return (inputs.cat1_up   ? INPUT_CAT1_UP   : 0) |
+           (inputs.cat1_down ? INPUT_CAT1_DOWN : 0) |
+           (inputs.cat2_up   ? INPUT_CAT2_UP   : 0) |
+           (inputs.cat2_down ? INPUT_CAT2_DOWN : 0) |
+           (inputs.toggle_single_player ? INPUT_TOGGLE : 0);
+}
+
+PongInputs unpack_inputs(uint8_t bits)
+{
+    PongInputs inputs;
+    inputs.cat1_up   = bits & INPUT_CAT1_UP;
+    inputs.cat1_down = bits & INPUT_CAT1_DOWN;
+    inputs.cat2_up   = bits & INPUT_CAT2_UP;
+    inputs.cat2_down = bits & INPUT_CAT2_DOWN;
+    inputs.toggle_single_player = bits & INPUT_TOGGLE;
+    return inputs;
+}
+
+void InputRecorder::record(const PongInputs &inputs)
+{
+    uint8_t bits = pack_inputs(inputs);
+    if (m_tick_count == 0 || bits != m_bits) m_changes.push_back({ (uint32_t) m_tick_count, bits });
+
+    m_bits = bits;
+    m_tick_count++;
+}
+
+bool InputRecorder::save(const char *filepath, const PongSim &final_state) const
+{
+    RecordingHeader header;
+    memcpy(header.magic, RECORDING_MAGIC, sizeof(RECORDING_MAGIC));
+    header.version        = FORMAT_VERSION;
+    header.fixed_timestep = FIXED_TIMESTEP;
+    header.change_count   = (uint32_t) m_changes.size();
+    header.tick_count     = (uint64_t) m_tick_count;
+    header.final_hash     = hash_state(final_state);
+
+    std::vector<unsigned char> bytes(sizeof(header) + m_changes.size() * CHANGE_SIZE);
+    memcpy(bytes.data(), &header, sizeof(header));
+
+    unsigned char *change = bytes.data() + sizeof(header);
+    for (const Change &c : m_changes)
+    {
+        memcpy(change, &c.tick, sizeof(c.tick));
+        change[sizeof(c.tick)] = c.bits;
+        change += CHANGE_SIZE;
+    }
+
+    std::ofstream file(filepath, std::ios::binary | std::ios::trunc);
+    file.write((const char *) bytes.data(), bytes.size());
+    return (bool) file;
+}
+
+bool InputReplay::load(const char *filepath)
+{
+    std::ifstream file(filepath, std::ios::binary);
+    RecordingHeader header;
+    if (!file || !file.read((char *) &header, sizeof(header)))
+    {
+        std::cout << "Unable to read input recording " << filepath << ".\n";
+        return false;
+    }
+
+    if (memcmp(header.magic, RECORDING_MAGIC, sizeof(RECORDING_MAGIC)) != 0 || header.version != InputRecorder::FORMAT_VERSION)
+    {
+        std::cout << filepath << " isn't an input recording this version can replay.\n";
+        return false;
+    }
+    // a different step size would send the ball somewhere else entirely
+    if (header.fixed_timestep != FIXED_TIMESTEP)
+    {
+        std::cout << filepath << " was recorded with a " << header.fixed_timestep << "s step, this build uses "
+                  << FIXED_TIMESTEP << "s.\n";
+        return false;
+    }
+
+    std::vector<unsigned char> changes((size_t) header.change_count * CHANGE_SIZE);
+    if (!file.read((char *) changes.data(), changes.size()))
+    {
+        std::cout << "Input recording " << filepath << " is truncated.\n";
+        return false;
+    }
+
+    m_ticks.resize(header.change_count);
+    m_bits.resize(header.change_count);
+    for (size_t i = 0; i < header.change_count; i++)
+    {
+        memcpy(&m_ticks[i], &changes[i * CHANGE_SIZE], sizeof(uint32_t));
+        m_bits[i] = changes[i * CHANGE_SIZE + sizeof(uint32_t)];
+    }
+    m_tick_count = (long long) header.tick_count;
+    m_final_hash = header.final_hash;
+
+    rewind();
+    return true;
+}
+
+PongInputs InputReplay::next()
+{
+    while (m_change < m_ticks.size() && m_ticks[m_change] <= m_tick) m_current = m_bits[m_change++];
+
+    m_tick++;
+    return unpack_inputs(m_current);
+}
+
+void InputReplay::rewind()
+{
+    m_tick    = 0;
+    m_change  = 0;
+    m_current = 0;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "PongSim.h"
+
+// one bit per key, the whole of PongInputs fits in a byte
+enum InputBits : uint8_t
+{
+    INPUT_CAT1_UP   = 1 << 0, // W
+    INPUT_CAT1_DOWN = 1 << 1, // S
+    INPUT_CAT2_UP   = 1 << 2, // Up
+    INPUT_CAT2_DOWN = 1 << 3, // Down
+    INPUT_TOGGLE    = 1 << 4, // T, only on the tick it was pressed
+};
+
+uint8_t pack_inputs(const PongInputs &inputs);
+PongInputs unpack_inputs(uint8_t bits);
+
+// Logs what was pressed on every simulation tick. Only the ticks where the bitmask changes are
+// kept (as tick index + bitmask), held keys cost nothing, and the file is written in one go on
+// save() along with the total tick count and the hash of the state the match ended in.
+class InputRecorder
+{
+public:
+    static constexpr uint32_t FORMAT_VERSION = 2; // 2: single-player cat2 is PaddleAI, older files play out differently
+
+    // call once per step(), with the inputs that step is given
+    void record(const PongInputs &inputs);
+
+    long long get_tick_count() const { return m_tick_count; }
+
+    // false if the file couldn't be written
+    bool save(const char *filepath, const PongSim &final_state) const;
+
+private:
+    struct Change
+    {
+        uint32_t tick;
+        uint8_t  bits;
+    };
+
+    std::vector<Change> m_changes;
+    uint8_t   m_bits = 0;
+    long long m_tick_count = 0;
+};
+
+// A recording read back in, handing out the same inputs tick by tick. Stepping a fresh PongSim
+// with FIXED_TIMESTEP and these inputs lands on exactly the state the recording ended in.
+class InputReplay
+{
+public:
+    // false (with a message) if the file is missing, truncated, from another format version or
+    // was recorded with a different FIXED_TIMESTEP
+    bool load(const char *filepath);
+
+    long long get_tick_count() const { return m_tick_count; }
+    uint64_t  get_final_hash() const { return m_final_hash; }
+
+    // ticks must be asked for in order, starting from 0; rewind() goes back to the start
+    PongInputs next();
+    void rewind();
+
+private:
+    std::vector<uint32_t> m_ticks;
+    std::vector<uint8_t>  m_bits;
+    long long m_tick_count = 0;
+    uint64_t  m_final_hash = 0;
+
+    long long m_tick = 0;
+    size_t    m_change = 0;
+    uint8_t   m_current = 0;
+};
@@ -0,0 +1,129 @@
+#include "MatchBatch.h"
+#include "CollisionKernel.h"
+
+void MatchBatch::resize(size_t match_count)
+{
+    size_t old_count = size();
+
+    ball_x.resize(match_count);
+    ball_y.resize(match_count);
+    velocity_x.resize(match_count);
+    velocity_y.resize(match_count);
+    ball_speed.resize(match_count);
+    cat1_y.resize(match_count);
+    cat2_y.resize(match_count);
+    cat2_ai_target_y.resize(match_count);
+    cat2_ai_reaction.resize(match_count);
+    cat2_ai_ball_direction.resize(match_count);
+    is_single_player_mode.resize(match_count);
+    is_game_over.resize(match_count);
+
+    for (size_t i = old_count; i < match_count; i++) reset(i);
+}
+
+void MatchBatch::reset(size_t index)
+{
+    load(index, PongSim());
+}
+
+void MatchBatch::load(size_t index, const PongSim &sim)
+{
+    ball_x[index]                = sim.ball_position.x;
+    ball_y[index]                = sim.ball_position.y;
+    velocity_x[index]            = sim.ball_velocity.x;
+    velocity_y[index]            = sim.ball_velocity.y;
+    ball_speed[index]            = sim.ball_speed;
+    cat1_y[index]                = sim.cat1_position.y;
+    cat2_y[index]                = sim.cat2_position.y;
+    cat2_ai_target_y[index]       = sim.cat2_ai.target_y;
+    cat2_ai_reaction[index]       = sim.cat2_ai.reaction;
+    cat2_ai_ball_direction[index] = sim.cat2_ai.ball_direction;
+    is_single_player_mode[index] = sim.is_single_player_mode;
+    is_game_over[index]          = sim.is_game_over;
+}
+
+PongSim MatchBatch::store(size_t index) const
+{
+    PongSim sim = PongSim();
+    sim.ball_position         = glm::vec3(ball_x[index], ball_y[index], 0.0f);
+    sim.ball_velocity         = glm::vec3(velocity_x[index], velocity_y[index], 0.0f);
+    sim.ball_speed            = ball_speed[index];
+    sim.cat1_position.y       = cat1_y[index];
+    sim.cat2_position.y       = cat2_y[index];
+    sim.cat2_ai.target_y       = cat2_ai_target_y[index];
+    sim.cat2_ai.reaction       = cat2_ai_reaction[index];
+    sim.cat2_ai.ball_direction = cat2_ai_ball_direction[index];
+    sim.is_single_player_mode = is_single_player_mode[index];
+    sim.is_game_over          = is_game_over[index];
+    return sim;
+}
+
+void MatchBatch::step_range(size_t begin, size_t end, const PongInputs *inputs, float delta_time,
+                            const AiSettings &ai_settings)
+{
+    // raw pointers so the compiler doesn't have to worry about the vectors changing under it
+    float   *c1  = cat1_y.data(), *c2 = cat2_y.data();
+    uint8_t *single_player = is_single_player_mode.data();
+    uint8_t *game_over     = is_game_over.data();
+
+    // each match only ever looks at its own slot, so doing the rules in three passes
+    // over the range gives the same result as step() does for one match at a time
+
+    // pass 1: player paddles
+    if (inputs != nullptr)
+    {
+        for (size_t i = begin; i < end; i++)
+        {
+            if (game_over[i]) continue;
+
+            const PongInputs &input = inputs[i];
+
+            if (input.toggle_single_player) single_player[i] = !single_player[i];
+
+            float cat1_movement = 0.0f;
+            if (input.cat1_up && c1[i] + INIT_POS_CAT1.y + PADDLE_HALF_HEIGHT < COURT_TOP) {
+                cat1_movement = 1.0f;
+            } else if (input.cat1_down && c1[i] + INIT_POS_CAT1.y - PADDLE_HALF_HEIGHT > COURT_BOTTOM) {
+                cat1_movement = -1.0f;
+            }
+            c1[i] += cat1_movement * PADDLE_SPEED * delta_time;
+
+            if (!single_player[i]) {
+                float cat2_movement = 0.0f;
+                if (input.cat2_up && c2[i] + INIT_POS_CAT2.y + PADDLE_HALF_HEIGHT < COURT_TOP) {
+                    cat2_movement = 1.0f;
+                } else if (input.cat2_down && c2[i] + INIT_POS_CAT2.y - PADDLE_HALF_HEIGHT > COURT_BOTTOM) {
+                    cat2_movement = -1.0f;
+                }
+                c2[i] += cat2_movement * PADDLE_SPEED * delta_time;
+            }
+        }
+    }
+
+    // pass 2: ball movement, bounces and goals
+    CollisionLanes lanes = { ball_x.data(), ball_y.data(), velocity_x.data(), velocity_y.data(),
+                             ball_speed.data(), cat1_y.data(), cat2_y.data(), is_game_over.data() };
+    resolve_collisions(lanes, begin, end, delta_time);
+
+    // pass 3: single-player mode paddle 2 plays itself, only while the ball is still in play
+    for (size_t i = begin; i < end; i++)
+    {
+        if (game_over[i] || !single_player[i]) continue;
+
+        AiPaddleState ai = { cat2_ai_target_y[i], cat2_ai_reaction[i], cat2_ai_ball_direction[i] };
+        float cat2 = c2[i] + INIT_POS_CAT2.y;
+        update_ai_paddle(cat2, ai, ball_x[i], ball_y[i], velocity_x[i], velocity_y[i], ai_settings, delta_time);
+        c2[i] = cat2 - INIT_POS_CAT2.y;
+
+        cat2_ai_target_y[i]       = ai.target_y;
+        cat2_ai_reaction[i]       = ai.reaction;
+        cat2_ai_ball_direction[i] = ai.ball_direction;
+    }
+}
+
+size_t MatchBatch::count_finished() const
+{
+    size_t finished = 0;
+    for (uint8_t over : is_game_over) finished += over;
+    return finished;
+}
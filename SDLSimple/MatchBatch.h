@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "PongSim.h"
+
+// N independent matches stored as one contiguous array per field (structure of arrays),
+// so stepping all of them is a single pass over a handful of float arrays.
+// Follows exactly the same rules as step() in PongSim.cpp.
+struct MatchBatch
+{
+    std::vector<float> ball_x,
+                       ball_y,
+                       velocity_x,
+                       velocity_y,
+                       ball_speed,
+                       cat1_y, // offset from INIT_POS_CAT1, paddles never move sideways
+                       cat2_y, // offset from INIT_POS_CAT2
+                       cat2_ai_target_y, // PongSim::cat2_ai, one array per field
+                       cat2_ai_reaction,
+                       cat2_ai_ball_direction;
+
+    std::vector<uint8_t> is_single_player_mode,
+                         is_game_over;
+
+    MatchBatch() = default;
+    explicit MatchBatch(size_t match_count) { resize(match_count); }
+
+    size_t size() const { return ball_x.size(); }
+
+    // new matches start out the same as a fresh PongSim
+    void resize(size_t match_count);
+    void reset(size_t index);
+
+    void   load(size_t index, const PongSim &sim);
+    PongSim store(size_t index) const;
+
+    // `inputs` is either nullptr (nobody pressing anything) or one PongInputs per match
+    void step(const PongInputs *inputs, float delta_time, const AiSettings &ai_settings = AiSettings())
+    {
+        step_range(0, size(), inputs, delta_time, ai_settings);
+    }
+    void step_range(size_t begin, size_t end, const PongInputs *inputs, float delta_time,
+                    const AiSettings &ai_settings = AiSettings());
+
+    size_t count_finished() const;
+};
@@ -0,0 +1,184 @@
+#define GL_SILENCE_DEPRECATION
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include "OffscreenContext.h"
+#include "GLSupport.h"
+
+#if __has_include(<EGL/egl.h>)
+    #include <EGL/egl.h>
+    #include <EGL/eglext.h>
+    #define OFFSCREEN_HAS_EGL 1
+#endif
+
+#if OFFSCREEN_HAS_EGL
+
+// Mesa's surfaceless platform needs no X or Wayland at all, otherwise take whatever the default is
+static EGLDisplay open_display()
+{
+    const char *client_extensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+    if (extension_list_contains(client_extensions, "EGL_MESA_platform_surfaceless"))
+    {
+        auto get_platform_display = (PFNEGLGETPLATFORMDISPLAYEXTPROC) eglGetProcAddress("eglGetPlatformDisplayEXT");
+        if (get_platform_display != nullptr)
+        {
+            EGLDisplay display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+            if (display != EGL_NO_DISPLAY && eglInitialize(display, nullptr, nullptr)) return display;
+        }
+    }
+
+    EGLDisplay display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    if (display != EGL_NO_DISPLAY && eglInitialize(display, nullptr, nullptr)) return display;
+    return EGL_NO_DISPLAY;
+}
+
+bool OffscreenContext::create(int width, int height, bool is_core_profile)
+{
+    m_width  = width;
+    m_height = height;
+
+    EGLDisplay display = open_display();
+    if (display == EGL_NO_DISPLAY || !eglBindAPI(EGL_OPENGL_API))
+    {
+        std::cerr << "Error: no EGL display with desktop OpenGL for offscreen rendering.\n";
+        return false;
+    }
+    m_display = display;
+
+    const EGLint config_attributes[] =
+    {
+        EGL_SURFACE_TYPE,    EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8, EGL_ALPHA_SIZE, 8,
+        EGL_NONE
+    };
+    EGLConfig config;
+    EGLint config_count = 0;
+    if (!eglChooseConfig(display, config_attributes, &config, 1, &config_count) || config_count == 0)
+    {
+        std::cerr << "Error: no EGL config for offscreen rendering.\n";
+        destroy();
+        return false;
+    }
+
+    // version and profile attributes come with EGL_KHR_create_context (and EGL 1.5)
+    const EGLint core_profile_attributes[] =
+    {
+        EGL_CONTEXT_MAJOR_VERSION_KHR, 3,
+        EGL_CONTEXT_MINOR_VERSION_KHR, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK_KHR, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT_KHR,
+        EGL_NONE
+    };
+    if (is_core_profile && !extension_list_contains(eglQueryString(display, EGL_EXTENSIONS), "EGL_KHR_create_context"))
+    {
+        std::cerr << "Error: EGL can't create core profile contexts here (no EGL_KHR_create_context).\n";
+        destroy();
+        return false;
+    }
+
+    EGLContext context = eglCreateContext(display, config, EGL_NO_CONTEXT, is_core_profile ? core_profile_attributes : nullptr);
+    if (context == EGL_NO_CONTEXT)
+    {
+        std::cerr << "Error: could not create an offscreen GL " << (is_core_profile ? "3.3 core profile " : "") << "context.\n";
+        destroy();
+        return false;
+    }
+    m_context = context;
+
+    // everything is drawn into the framebuffer object below, a surface is only needed where
+    // the driver can't make a context current without one
+    EGLSurface surface = EGL_NO_SURFACE;
+    if (!extension_list_contains(eglQueryString(display, EGL_EXTENSIONS), "EGL_KHR_surfaceless_context"))
+    {
+        const EGLint pbuffer_attributes[] = { EGL_WIDTH, width, EGL_HEIGHT, height, EGL_NONE };
+        surface   = eglCreatePbufferSurface(display, config, pbuffer_attributes);
+        m_surface = surface;
+    }
+
+    if (!eglMakeCurrent(display, surface, surface, context))
+    {
+        std::cerr << "Error: could not make the offscreen GL context current.\n";
+        destroy();
+        return false;
+    }
+    ShaderProgram::reset_bound_program();
+
+    glGenRenderbuffers(1, &m_renderbuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, m_renderbuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+
+    glGenFramebuffers(1, &m_framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_renderbuffer);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        std::cerr << "Error: offscreen framebuffer is incomplete.\n";
+        destroy();
+        return false;
+    }
+    return true;
+}
+
+void OffscreenContext::destroy()
+{
+    if (m_display == nullptr) return;
+    EGLDisplay display = (EGLDisplay) m_display;
+
+    if (m_framebuffer != 0)
+    {
+        glDeleteFramebuffers(1, &m_framebuffer);
+        glDeleteRenderbuffers(1, &m_renderbuffer);
+        m_framebuffer = m_renderbuffer = 0;
+    }
+
+    eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (m_surface != nullptr) eglDestroySurface(display, (EGLSurface) m_surface);
+    if (m_context != nullptr) eglDestroyContext(display, (EGLContext) m_context);
+    eglTerminate(display);
+    ShaderProgram::reset_bound_program();
+
+    m_display = m_surface = m_context = nullptr;
+}
+
+#else
+
+bool OffscreenContext::create(int width, int height)
+{
+    std::cerr << "Error: offscreen rendering needs EGL, which this build doesn't have.\n";
+    return false;
+}
+
+void OffscreenContext::destroy()
+{
+}
+
+#endif
+
+void OffscreenContext::read_pixels(std::vector<unsigned char> &pixels) const
+{
+    pixels.resize((size_t) m_width * m_height * 4);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, m_width, m_height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+}
+
+bool OffscreenContext::write_ppm(const char *filepath) const
+{
+    std::vector<unsigned char> pixels;
+    read_pixels(pixels);
+
+    FILE *file = fopen(filepath, "wb");
+    if (file == nullptr) return false;
+
+    // PPM goes top to bottom and has no alpha
+    fprintf(file, "P6\n%d %d\n255\n", m_width, m_height);
+    std::vector<unsigned char> row((size_t) m_width * 3);
+    for (int y = m_height - 1; y >= 0; y--)
+    {
+        const unsigned char *source = &pixels[(size_t) y * m_width * 4];
+        for (int x = 0; x < m_width; x++) memcpy(&row[x * 3], &source[x * 4], 3);
+        fwrite(row.data(), 1, row.size(), file);
+    }
+    return fclose(file) == 0;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <vector>
+#include "ShaderProgram.h"
+
+// A GL context with no window: EGL on Mesa's surfaceless platform (falling back to a pbuffer on
+// the default display), rendering into a framebuffer object of the requested size. Lets render()
+// run on CI and benchmark hosts that have neither a display nor a GPU (llvmpipe does the work).
+class OffscreenContext
+{
+public:
+    ~OffscreenContext() { destroy(); }
+
+    // makes the context current with the framebuffer bound, false (and a message) if there's no EGL.
+    // is_core_profile asks for a GL 3.3 core profile context instead of whatever the default is
+    bool create(int width, int height, bool is_core_profile = false);
+    void destroy();
+
+    // bottom-up RGBA rows, the way glReadPixels hands them back
+    void read_pixels(std::vector<unsigned char> &pixels) const;
+
+    // binary PPM of what's currently in the framebuffer
+    bool write_ppm(const char *filepath) const;
+
+    int get_width()  const { return m_width; }
+    int get_height() const { return m_height; }
+
+private:
+    int m_width  = 0;
+    int m_height = 0;
+
+    // EGL handles, kept opaque so this header doesn't drag EGL in everywhere
+    void *m_display = nullptr;
+    void *m_surface = nullptr;
+    void *m_context = nullptr;
+
+    GLuint m_framebuffer  = 0;
+    GLuint m_renderbuffer = 0;
+};
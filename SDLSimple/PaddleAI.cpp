@@ -0,0 +1,37 @@
+#include <cmath>
+#include "PaddleAI.h"
+#include "SweptCollision.h"
+#include "Hash.h"
+
+float predict_intercept_y(float x, float y, float velocity_x, float velocity_y, float contact_x)
+{
+    float time = (contact_x - x) / velocity_x; // speed scales both axes the same, so it cancels out
+    if (!(time > 0.0f)) return 0.0f;
+
+    // fold the unbounced y back into the court: every span it travels is one more wall bounce
+    float span   = BALL_TOP_LIMIT - BALL_BOTTOM_LIMIT,
+          period = 2.0f * span;
+    float folded = std::fmod(y + velocity_y * time - BALL_BOTTOM_LIMIT, period);
+    if (folded < 0.0f) folded += period;
+    if (folded > span) folded = period - folded;
+
+    return BALL_BOTTOM_LIMIT + folded;
+}
+
+// -1..1, the same for the same ball every time so replays and rollbacks see the same miss
+static float aim_noise(float ball_x, float ball_y, float velocity_x, float velocity_y)
+{
+    const float ball[4] = { ball_x, ball_y, velocity_x, velocity_y };
+    uint64_t hash = hash_bytes(ball, sizeof(ball));
+    return (float) (hash >> 40) / (float) (1 << 23) - 1.0f;
+}
+
+void plan_ai_paddle(AiPaddleState &ai, float ball_x, float ball_y, float velocity_x, float velocity_y,
+                    const AiSettings &settings)
+{
+    ai.target_y = predict_intercept_y(ball_x, ball_y, velocity_x, velocity_y, CAT2_CONTACT_X);
+    if (velocity_x > 0.0f) ai.target_y += settings.aim_error * aim_noise(ball_x, ball_y, velocity_x, velocity_y);
+
+    // the paddle can't get its centre any closer to the walls than this
+    ai.target_y = std::fmin(std::fmax(ai.target_y, COURT_BOTTOM + PADDLE_HALF_HEIGHT), COURT_TOP - PADDLE_HALF_HEIGHT);
+}
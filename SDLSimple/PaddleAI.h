@@ -0,0 +1,59 @@
+#pragma once
+
+#include "PongRules.h"
+
+// The single-player cat2 controller. Rather than chasing the ball it works out where the ball
+// will cross its paddle face: the straight-line path is unfolded across the wall bounces (the
+// ball centre reflects between BALL_BOTTOM_LIMIT and BALL_TOP_LIMIT, so the crossing y is a
+// triangle wave of the unbounced y) which makes the prediction O(1) however many bounces there
+// are. It only re-plans when the ball turns around, after a reaction delay, and aims off by a
+// bounded error, so it can be beaten. Glm-free like SweptCollision, MatchBatch runs it per match.
+
+struct AiSettings
+{
+    float reaction_time = 0.2f;              // seconds between the ball turning around and the plan changing
+    float aim_error     = 1.2f;              // the plan is off by up to this much either way; past the paddle half height (1) it can miss
+    float paddle_speed  = AUTO_PADDLE_SPEED; // units per second
+};
+
+// what the controller remembers between ticks, one of these per match
+struct AiPaddleState
+{
+    float target_y       = 0.0f;  // paddle centre it's heading for
+    float reaction       = -1.0f; // seconds left before re-planning, negative once the plan is made
+    float ball_direction = 0.0f;  // sign of the ball's x velocity when the plan was last triggered
+};
+
+// y of the ball centre when it reaches contact_x, walls included; when the ball is heading away
+// from contact_x the paddle may as well wait in the middle, so that returns 0
+float predict_intercept_y(float x, float y, float velocity_x, float velocity_y, float contact_x);
+
+// sets ai.target_y from where the ball is now; once per rally, so it stays out of line
+void plan_ai_paddle(AiPaddleState &ai, float ball_x, float ball_y, float velocity_x, float velocity_y,
+                    const AiSettings &settings);
+
+// moves the paddle (its centre y) for delta_time towards the current plan. This runs every tick
+// of every single-player match, so it's inline and clamps by hand: std::fmin/fmax stay calls into
+// libm without -ffast-math, which made it several times slower inside MatchBatch
+inline void update_ai_paddle(float &paddle_y, AiPaddleState &ai, float ball_x, float ball_y,
+                             float velocity_x, float velocity_y, const AiSettings &settings, float delta_time)
+{
+    // the ball turned around (or this is the first look at it): react after a moment
+    float direction = velocity_x > 0.0f ? 1.0f : -1.0f;
+    if (direction != ai.ball_direction)
+    {
+        ai.ball_direction = direction;
+        ai.reaction       = settings.reaction_time;
+    }
+
+    if (ai.reaction >= 0.0f)
+    {
+        ai.reaction -= delta_time;
+        if (ai.reaction < 0.0f) plan_ai_paddle(ai, ball_x, ball_y, velocity_x, velocity_y, settings);
+    }
+
+    // straight at the target, without overshooting it
+    float reach = settings.paddle_speed * delta_time,
+          move  = ai.target_y - paddle_y;
+    paddle_y += move < -reach ? -reach : (move > reach ? reach : move);
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+// plain float constants for the game rules, kept free of glm so SIMD code can use them too
+
+// court bounds, these match the orthographic projection set up in main.cpp
+constexpr float COURT_TOP    =  3.75f,
+                COURT_BOTTOM = -3.75f,
+                COURT_RIGHT  =  5.0f,
+                COURT_LEFT   = -5.0f;
+
+constexpr float PADDLE_HALF_WIDTH  = 0.5f,
+                PADDLE_HALF_HEIGHT = 1.0f,
+                BALL_HALF_SIZE     = 0.5f;
+
+// the paddles start centred vertically and only ever move up and down
+constexpr float CAT1_X = -4.0f,
+                CAT2_X =  4.0f;
+
+constexpr float PADDLE_SPEED      = 4.0f,
+                AUTO_PADDLE_SPEED = 2.0f;
+
+// the simulation always advances in steps of this size, no matter the frame rate
+constexpr float FIXED_TIMESTEP = 1.0f / 120.0f,
+                MAX_FRAME_TIME = 0.25f; // clamp for long frames so we don't spiral
@@ -0,0 +1,64 @@
+#include "PongSim.h"
+#include "SweptCollision.h"
+#include "Hash.h"
+
+void step(PongSim &state, const PongInputs &inputs, float delta_time, const AiSettings &ai_settings)
+{
+    if (state.is_game_over) return;
+
+    if (inputs.toggle_single_player) {
+        state.is_single_player_mode = !state.is_single_player_mode;
+    }
+
+    // Cat1 (WASD Controls)
+    glm::vec3 cat1_movement = glm::vec3(0.0f);
+    if (inputs.cat1_up && state.cat1_position.y + INIT_POS_CAT1.y + PADDLE_HALF_HEIGHT < COURT_TOP) {
+        cat1_movement.y = 1.0f;
+    } else if (inputs.cat1_down && state.cat1_position.y + INIT_POS_CAT1.y - PADDLE_HALF_HEIGHT > COURT_BOTTOM) {
+        cat1_movement.y = -1.0f;
+    }
+    state.cat1_position += cat1_movement * PADDLE_SPEED * delta_time;
+
+    // Cat2 (Arrow Keys) allowed when game is NOT in single-player mode
+    if (!state.is_single_player_mode) {
+        glm::vec3 cat2_movement = glm::vec3(0.0f);
+        if (inputs.cat2_up && state.cat2_position.y + INIT_POS_CAT2.y + PADDLE_HALF_HEIGHT < COURT_TOP) {
+            cat2_movement.y = 1.0f;
+        } else if (inputs.cat2_down && state.cat2_position.y + INIT_POS_CAT2.y - PADDLE_HALF_HEIGHT > COURT_BOTTOM) {
+            cat2_movement.y = -1.0f;
+        }
+        state.cat2_position += cat2_movement * PADDLE_SPEED * delta_time;
+    }
+
+    // move the ball impact by impact so it can't tunnel through a paddle on a long step
+    bool is_goal = sweep_ball(state.ball_position.x, state.ball_position.y,
+                              state.ball_velocity.x, state.ball_velocity.y, state.ball_speed,
+                              state.cat1_position.y + INIT_POS_CAT1.y, state.cat2_position.y + INIT_POS_CAT2.y,
+                              delta_time);
+
+    // if ball goes out of bounds horizontally, end game
+    if (is_goal) {
+        state.is_game_over = true;
+        return;
+    }
+
+    // single-player mode paddle 2 plays itself
+    if (state.is_single_player_mode) {
+        float cat2_y = state.cat2_position.y + INIT_POS_CAT2.y;
+        update_ai_paddle(cat2_y, state.cat2_ai, state.ball_position.x, state.ball_position.y,
+                         state.ball_velocity.x, state.ball_velocity.y, ai_settings, delta_time);
+        state.cat2_position.y = cat2_y - INIT_POS_CAT2.y;
+    }
+}
+
+uint64_t hash_state(const PongSim &state)
+{
+    uint64_t hash = hash_bytes(&state.cat1_position, sizeof(state.cat1_position));
+    hash = hash_bytes(&state.cat2_position, sizeof(state.cat2_position), hash);
+    hash = hash_bytes(&state.ball_position, sizeof(state.ball_position), hash);
+    hash = hash_bytes(&state.ball_velocity, sizeof(state.ball_velocity), hash);
+    hash = hash_bytes(&state.ball_speed, sizeof(state.ball_speed), hash);
+    hash = hash_bytes(&state.is_single_player_mode, sizeof(state.is_single_player_mode), hash);
+    hash = hash_bytes(&state.cat2_ai, sizeof(state.cat2_ai), hash); // three floats, no padding
+    return hash_bytes(&state.is_game_over, sizeof(state.is_game_over), hash);
+}
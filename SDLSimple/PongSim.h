@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include "glm/vec3.hpp"
+#include "PongRules.h"
+#include "PaddleAI.h"
+
+constexpr glm::vec3 INIT_POS_CAT1 = glm::vec3(CAT1_X, 0.0f, 0.0f),
+                    INIT_POS_CAT2 = glm::vec3(CAT2_X, 0.0f, 0.0f),
+                    INIT_POS_BALL = glm::vec3(0.0f, 0.0f, 0.0f),
+                    INIT_VEL_BALL = glm::vec3(1.0f, 1.0f, 0.0f); // spawn & start with a diagonal movement
+
+// everything the game rules need, no SDL or GL in here so it can run without a window
+struct PongSim
+{
+    glm::vec3 cat1_position = glm::vec3(0.0f, 0.0f, 0.0f); // offset from INIT_POS_CAT1
+    glm::vec3 cat2_position = glm::vec3(0.0f, 0.0f, 0.0f); // offset from INIT_POS_CAT2
+
+    glm::vec3 ball_position = INIT_POS_BALL;
+    glm::vec3 ball_velocity = INIT_VEL_BALL;
+    float     ball_speed    = 1.0f;
+
+    bool          is_single_player_mode = false;
+    AiPaddleState cat2_ai; // drives cat2 in single-player mode
+
+    bool is_game_over = false;
+};
+
+// what the players are pressing during a single step
+struct PongInputs
+{
+    bool cat1_up   = false,
+         cat1_down = false,
+         cat2_up   = false,
+         cat2_down = false;
+
+    bool toggle_single_player = false; // edge triggered, only the 'T' key press itself
+};
+
+// advances the state by delta_time seconds; only touches `state`
+void step(PongSim &state, const PongInputs &inputs, float delta_time, const AiSettings &ai_settings = AiSettings());
+
+// FNV-1a over every field (not the struct's bytes, those include padding), so two runs can be
+// checked for ending up in exactly the same state
+uint64_t hash_state(const PongSim &state);
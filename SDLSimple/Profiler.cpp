@@ -0,0 +1,75 @@
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "Profiler.h"
+
+// every buffer ever handed out; they outlive their threads so a dump still sees what they did
+static std::mutex g_buffers_mutex;
+static std::vector<std::unique_ptr<Profiler::ThreadBuffer>> g_buffers;
+
+Profiler::ThreadBuffer *Profiler::register_thread()
+{
+    std::lock_guard<std::mutex> lock(g_buffers_mutex);
+
+    g_buffers.push_back(std::make_unique<ThreadBuffer>());
+    ThreadBuffer *buffer = g_buffers.back().get();
+    buffer->thread_id = (int) g_buffers.size();
+    buffer->name      = "thread " + std::to_string(buffer->thread_id);
+
+    s_thread_buffer = buffer;
+    return buffer;
+}
+
+void Profiler::set_thread_name(const char *name)
+{
+    ThreadBuffer *buffer = s_thread_buffer != nullptr ? s_thread_buffer : register_thread();
+
+    std::lock_guard<std::mutex> lock(g_buffers_mutex);
+    buffer->name = name;
+}
+
+bool Profiler::write_chrome_trace(const char *filepath)
+{
+    FILE *file = fopen(filepath, "w");
+    if (file == nullptr) return false;
+
+    std::lock_guard<std::mutex> lock(g_buffers_mutex);
+
+    // timestamps are relative to the earliest surviving event so the numbers stay readable
+    int64_t origin_ns = INT64_MAX;
+    for (const auto &buffer : g_buffers)
+    {
+        size_t head = buffer->head.load(std::memory_order_acquire);
+        size_t first = head > EVENTS_PER_THREAD ? head - EVENTS_PER_THREAD : 0;
+        for (size_t i = first; i < head; i++)
+        {
+            origin_ns = std::min(origin_ns, buffer->events[i & (EVENTS_PER_THREAD - 1)].start_ns);
+        }
+    }
+
+    fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    bool is_first = true;
+    for (const auto &buffer : g_buffers)
+    {
+        fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+                is_first ? "" : ",\n", buffer->thread_id, buffer->name.c_str());
+        is_first = false;
+
+        size_t head = buffer->head.load(std::memory_order_acquire);
+        size_t first = head > EVENTS_PER_THREAD ? head - EVENTS_PER_THREAD : 0;
+        for (size_t i = first; i < head; i++)
+        {
+            const Event &event = buffer->events[i & (EVENTS_PER_THREAD - 1)];
+
+            // complete ("X") events, trace_event wants microseconds
+            fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                    event.name, buffer->thread_id, (event.start_ns - origin_ns) / 1000.0,
+                    (event.end_ns - event.start_ns) / 1000.0);
+        }
+    }
+    fprintf(file, "\n]}\n");
+
+    return fclose(file) == 0;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+// Scoped-zone profiler. PROFILE_ZONE("name") times the rest of the enclosing block and appends
+// it to a ring buffer owned by the calling thread, so recording takes no locks; only the last
+// EVENTS_PER_THREAD zones of each thread are kept. write_chrome_trace() turns everything
+// recorded so far into Chrome trace_event JSON (chrome://tracing, ui.perfetto.dev).
+// Zone names are stored as pointers, so they have to be string literals.
+class Profiler
+{
+public:
+    static constexpr size_t EVENTS_PER_THREAD = 1 << 14;
+
+    struct Event
+    {
+        const char *name;
+        int64_t     start_ns;
+        int64_t     end_ns;
+    };
+
+    struct ThreadBuffer
+    {
+        std::string         name;
+        int                 thread_id;
+        std::atomic<size_t> head { 0 }; // events ever recorded, the newest is at (head - 1) % EVENTS_PER_THREAD
+        Event               events[EVENTS_PER_THREAD];
+    };
+
+    static int64_t now_ns()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    static void record(const char *name, int64_t start_ns, int64_t end_ns)
+    {
+        ThreadBuffer *buffer = s_thread_buffer != nullptr ? s_thread_buffer : register_thread();
+        size_t head = buffer->head.load(std::memory_order_relaxed);
+        buffer->events[head & (EVENTS_PER_THREAD - 1)] = { name, start_ns, end_ns };
+        buffer->head.store(head + 1, std::memory_order_release);
+    }
+
+    // shows up as the track's name in the trace, defaults to "thread <n>"
+    static void set_thread_name(const char *name);
+
+    // best called while the other threads are idle, a zone finishing mid-dump can tear its slot
+    static bool write_chrome_trace(const char *filepath);
+
+private:
+    static inline thread_local ThreadBuffer *s_thread_buffer = nullptr;
+
+    static ThreadBuffer *register_thread();
+};
+
+class ProfileZone
+{
+public:
+    explicit ProfileZone(const char *name) : m_name(name), m_start_ns(Profiler::now_ns()) {}
+    ~ProfileZone() { Profiler::record(m_name, m_start_ns, Profiler::now_ns()); }
+
+    ProfileZone(const ProfileZone &) = delete;
+    ProfileZone &operator=(const ProfileZone &) = delete;
+
+private:
+    const char *m_name;
+    int64_t     m_start_ns;
+};
+
+#define PROFILE_CONCATENATE_(a, b) a##b
+#define PROFILE_CONCATENATE(a, b) PROFILE_CONCATENATE_(a, b)
+#define PROFILE_ZONE(name) ProfileZone PROFILE_CONCATENATE(profile_zone_, __LINE__)(name)
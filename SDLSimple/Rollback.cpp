@@ -0,0 +1,167 @@
+#include <chrono>
+#include "Rollback.h"
+#include "UdpSocket.h"
+#include "Profiler.h"
+
+// magic, sender's player, input count, first input's tick, ack; then one byte per input
+constexpr unsigned char PACKET_MAGIC[2] = { 'P', 'R' };
+constexpr size_t PACKET_HEADER_SIZE = 12;
+
+static void put_u32(unsigned char *at, uint32_t value)
+{
+    for (int i = 0; i < 4; i++) at[i] = (unsigned char) (value >> (8 * i));
+}
+
+static uint32_t get_u32(const unsigned char *at)
+{
+    return (uint32_t) at[0] | (uint32_t) at[1] << 8 | (uint32_t) at[2] << 16 | (uint32_t) at[3] << 24;
+}
+
+void RollbackSession::start(int local_player, const PongSim &initial_state, bool is_restarting_matches)
+{
+    *this = RollbackSession();
+    m_local_player          = local_player;
+    m_state                 = initial_state;
+    m_initial_state         = initial_state;
+    m_is_restarting_matches = is_restarting_matches;
+    m_game_over_tick        = initial_state.is_game_over && !is_restarting_matches ? 0 : -1;
+}
+
+uint8_t RollbackSession::predict_remote(long long tick) const
+{
+    if (tick < m_remote_confirmed) return m_remote_inputs[slot(tick)];
+
+    // players mostly hold keys down, so "the same as last time" is the best cheap guess
+    return m_remote_confirmed > 0 ? m_remote_inputs[slot(m_remote_confirmed - 1)] : 0;
+}
+
+PongInputs RollbackSession::combine(uint8_t local_bits, uint8_t remote_bits) const
+{
+    uint8_t cat1 = m_local_player == 0 ? local_bits : remote_bits,
+            cat2 = m_local_player == 0 ? remote_bits : local_bits;
+
+    PongInputs inputs;
+    inputs.cat1_up   = cat1 & PADDLE_UP;
+    inputs.cat1_down = cat1 & PADDLE_DOWN;
+    inputs.cat2_up   = cat2 & PADDLE_UP;
+    inputs.cat2_down = cat2 & PADDLE_DOWN;
+    return inputs;
+}
+
+void RollbackSession::simulate(long long tick)
+{
+    size_t index = slot(tick);
+    m_snapshots[index] = m_state;
+
+    uint8_t remote = predict_remote(tick);
+    m_remote_predicted[index] = remote;
+    bool was_game_over = m_state.is_game_over;
+    step(m_state, combine(m_local_inputs[index], remote), FIXED_TIMESTEP);
+
+    if (m_is_restarting_matches && m_state.is_game_over) m_state = m_initial_state;
+    else if (!m_state.is_game_over) m_game_over_tick = -1; // a re-simulation took the goal back
+    else if (!was_game_over) m_game_over_tick = tick + 1;
+}
+
+void RollbackSession::synchronise()
+{
+    if (m_rollback_from < 0) return;
+
+    PROFILE_ZONE("rollback");
+    auto start = std::chrono::steady_clock::now();
+
+    m_state = m_snapshots[slot(m_rollback_from)];
+    for (long long tick = m_rollback_from; tick < m_tick; tick++) simulate(tick);
+
+    double elapsed_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    int depth = (int) (m_tick - m_rollback_from);
+
+    m_stats.rollbacks++;
+    m_stats.resimulated_ticks  += depth;
+    m_stats.deepest_rollback    = depth > m_stats.deepest_rollback ? depth : m_stats.deepest_rollback;
+    m_stats.slowest_rollback_ms = elapsed_ms > m_stats.slowest_rollback_ms ? elapsed_ms : m_stats.slowest_rollback_ms;
+    m_stats.total_rollback_ms  += elapsed_ms;
+
+    m_rollback_from = -1;
+}
+
+bool RollbackSession::advance(uint8_t local_bits)
+{
+    synchronise();
+
+    // nothing left to play, unless a rollback takes the goal back
+    if (m_game_over_tick >= 0 && m_tick >= m_game_over_tick) return false;
+
+    // too far past what we know of the peer (or what they know of us) to roll back safely
+    if (m_tick - m_remote_confirmed >= MAX_PREDICTION_TICKS || m_tick - m_local_acked >= HISTORY_TICKS)
+    {
+        m_stats.stalls++;
+        return false;
+    }
+
+    m_local_inputs[slot(m_tick)] = local_bits;
+    simulate(m_tick);
+    m_tick++;
+    return true;
+}
+
+bool RollbackSession::read_packet(const unsigned char *data, size_t size)
+{
+    if (size < PACKET_HEADER_SIZE || data[0] != PACKET_MAGIC[0] || data[1] != PACKET_MAGIC[1] ||
+        data[2] == m_local_player || size != PACKET_HEADER_SIZE + data[3])
+    {
+        return false;
+    }
+
+    size_t    count = data[3];
+    long long first = get_u32(data + 4),
+              ack   = get_u32(data + 8);
+
+    if (ack > m_local_acked) m_local_acked = ack < m_tick ? ack : m_tick;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        long long tick = first + (long long) i;
+        if (tick < m_remote_confirmed) continue; // had it already
+        if (tick > m_remote_confirmed) break;    // a gap, a later packet will fill it in
+
+        // a peer this far ahead would overwrite inputs a rollback may still need
+        if (tick >= m_tick + HISTORY_TICKS - MAX_PREDICTION_TICKS) break;
+
+        uint8_t bits = data[PACKET_HEADER_SIZE + i];
+        m_remote_inputs[slot(tick)] = bits;
+        m_remote_confirmed++;
+
+        // already simulated with a guess that turned out wrong
+        if (tick < m_tick && m_remote_predicted[slot(tick)] != bits && (m_rollback_from < 0 || tick < m_rollback_from))
+        {
+            m_rollback_from = tick;
+        }
+    }
+    return true;
+}
+
+size_t RollbackSession::write_packet(unsigned char *buffer, size_t capacity) const
+{
+    size_t count = (size_t) (m_tick - m_local_acked);
+    if (capacity < PACKET_HEADER_SIZE + count) return 0;
+
+    buffer[0] = PACKET_MAGIC[0];
+    buffer[1] = PACKET_MAGIC[1];
+    buffer[2] = (unsigned char) m_local_player;
+    buffer[3] = (unsigned char) count;
+    put_u32(buffer + 4, (uint32_t) m_local_acked);
+    put_u32(buffer + 8, (uint32_t) m_remote_confirmed);
+
+    for (size_t i = 0; i < count; i++) buffer[PACKET_HEADER_SIZE + i] = m_local_inputs[slot(m_local_acked + (long long) i)];
+    return PACKET_HEADER_SIZE + count;
+}
+
+void exchange_packets(RollbackSession &session, UdpSocket &socket, double now)
+{
+    unsigned char packet[UdpSocket::MAX_PACKET_SIZE];
+    while (size_t size = socket.receive(packet, sizeof(packet))) session.read_packet(packet, size);
+
+    if (size_t size = session.write_packet(packet, sizeof(packet))) socket.send(packet, size, now);
+    socket.flush(now);
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "PongSim.h"
+
+// what one player pressed on one tick, for their own paddle whichever side it's on
+enum PaddleBits : uint8_t
+{
+    PADDLE_UP   = 1 << 0,
+    PADDLE_DOWN = 1 << 1,
+};
+
+// GGPO-style rollback for two-player matches over the network. The local player's inputs apply
+// on the tick they're pressed (no added input delay). The other player's inputs are predicted
+// by repeating the last one we know, and when their real inputs arrive and turn out different,
+// the state is restored from the snapshot kept for that tick and the ticks since are simulated
+// again. PongSim is a plain struct, so a snapshot is a copy.
+//
+// The session only deals in packets (write_packet / read_packet); moving them is up to the
+// caller, e.g. with UdpSocket. Every packet repeats all the local inputs the peer hasn't
+// acknowledged yet, so lost packets need no resends, and acknowledges the peer's inputs in return.
+class RollbackSession
+{
+public:
+    static constexpr int HISTORY_TICKS        = 64; // snapshots and inputs kept, a power of two
+    static constexpr int MAX_PREDICTION_TICKS = 16; // how far we may run past the peer's last known input
+
+    static constexpr size_t MAX_PACKET_SIZE = 12 + HISTORY_TICKS;
+
+    struct Stats
+    {
+        size_t rollbacks           = 0;
+        size_t resimulated_ticks   = 0;
+        int    deepest_rollback    = 0;     // in ticks
+        double slowest_rollback_ms = 0.0;   // restore + re-simulate
+        double total_rollback_ms   = 0.0;
+        size_t stalls              = 0;     // advance() calls refused for being too far ahead
+    };
+
+    // local_player 0 plays cat1, 1 plays cat2; both peers have to start from the same state. With
+    // is_restarting_matches a match that ends goes straight back to initial_state on that tick,
+    // for soak tests that need the ball kept moving
+    void start(int local_player, const PongSim &initial_state = PongSim(), bool is_restarting_matches = false);
+
+    // applies any pending correction, then simulates one tick with `local_bits` (PaddleBits).
+    // False, and nothing simulated, while we're MAX_PREDICTION_TICKS ahead of the peer (the
+    // caller should try again on its next tick) or once the match has ended.
+    bool advance(uint8_t local_bits);
+
+    // applies a pending correction without simulating a new tick
+    void synchronise();
+
+    // false for anything that isn't a well-formed packet from a session like this one
+    bool   read_packet(const unsigned char *data, size_t size);
+    size_t write_packet(unsigned char *buffer, size_t capacity) const;
+
+    const PongSim &get_state() const { return m_state; }
+    long long get_tick() const { return m_tick; }
+
+    // the peer's inputs are known for every tick before this one, so the state up to it is final
+    long long get_confirmed_tick() const { return m_remote_confirmed; }
+
+    // the tick the match ended on as things stand, -1 while it's still going (and always with
+    // is_restarting_matches). A predicted goal can still be rolled back, see is_match_over()
+    long long get_game_over_tick() const { return m_game_over_tick; }
+
+    // the match has ended and the peer's inputs confirm it, the peer will end on the same tick
+    bool is_match_over() const
+    {
+        return m_game_over_tick >= 0 && m_remote_confirmed >= m_game_over_tick && m_rollback_from < 0;
+    }
+
+    const Stats &get_stats() const { return m_stats; }
+
+private:
+    static size_t slot(long long tick) { return (size_t) (tick & (HISTORY_TICKS - 1)); }
+
+    uint8_t   predict_remote(long long tick) const;
+    PongInputs combine(uint8_t local_bits, uint8_t remote_bits) const;
+    void      simulate(long long tick); // snapshots m_state as the start of `tick`, then steps it
+
+    int     m_local_player = 0;
+    PongSim m_state;
+    PongSim m_initial_state;
+    bool    m_is_restarting_matches = false;
+
+    long long m_tick             = 0;  // next tick to simulate
+    long long m_remote_confirmed = 0;  // peer inputs known for every tick before this
+    long long m_local_acked      = 0;  // the peer has our inputs for every tick before this
+    long long m_rollback_from    = -1; // earliest tick simulated with a wrong prediction, -1 for none
+    long long m_game_over_tick   = -1; // first tick whose start state is game over, -1 for none
+
+    PongSim m_snapshots[HISTORY_TICKS];
+    uint8_t m_local_inputs[HISTORY_TICKS]     = {};
+    uint8_t m_remote_inputs[HISTORY_TICKS]    = {};
+    uint8_t m_remote_predicted[HISTORY_TICKS] = {}; // what the last simulation of each tick assumed
+
+    Stats m_stats;
+};
+
+class UdpSocket;
+
+// everything that arrived goes into the session, then our unacknowledged inputs go out
+void exchange_packets(RollbackSession &session, UdpSocket &socket, double now);
@@ -1,26 +1,171 @@
 #define GL_SILENCE_DEPRECATION
 
+#include <cstring>
+#include <cstdio>
+#include <vector>
+#include <sys/stat.h>
 #include "ShaderProgram.h"
+#include "Hash.h"
+#include "GLSupport.h"
+#include "Profiler.h"
+
+#ifdef _WINDOWS
+    #include <direct.h>
+#endif
+
+GLuint          ShaderProgram::s_bound_program = 0;
+ShaderCallStats ShaderProgram::s_stats         = ShaderCallStats();
+
+// glGetProgramBinary / glProgramBinary are core from GL 4.1, older drivers may still have the extension
+static bool supports_program_binaries()
+{
+    if (!gl_version_at_least(4, 1) && !gl_has_extension("GL_ARB_get_program_binary")) return false;
+
+    GLint format_count = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &format_count);
+    return format_count > 0;
+}
+
+// a binary is only good for the exact sources and driver that produced it, so both go into the name
+static std::string program_binary_path(const std::string &vertex_source, const std::string &fragment_source)
+{
+    uint64_t hash = hash_bytes(&SHADER_CACHE_VERSION, sizeof(SHADER_CACHE_VERSION));
+    hash = hash_bytes(vertex_source.data(), vertex_source.size(), hash);
+    hash = hash_bytes(fragment_source.data(), fragment_source.size(), hash);
+
+    for (GLenum name : { GL_VENDOR, GL_RENDERER, GL_VERSION })
+    {
+        const char *value = (const char *) glGetString(name);
+        if (value != nullptr) hash = hash_bytes(value, strlen(value) + 1, hash);
+    }
+
+    char filename[32];
+    snprintf(filename, sizeof(filename), "%016llx.bin", (unsigned long long) hash);
+    return std::string(SHADER_CACHE_DIRECTORY) + "/" + filename;
+}
+
+// sits at the start of every cached binary, the driver's blob follows right after it
+struct ProgramBinaryHeader
+{
+    char     magic[4];
+    uint32_t format;
+    uint32_t length;
+};
+
+constexpr char PROGRAM_BINARY_MAGIC[4] = { 'P', 'S', 'H', 'B' };
+
+bool ShaderProgram::load_program_binary(const std::string &path)
+{
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file) return false;
+    std::streamoff file_size = file.tellg();
+    file.seekg(0);
+
+    ProgramBinaryHeader header;
+    if (!file.read((char *) &header, sizeof(header)) ||
+        memcmp(header.magic, PROGRAM_BINARY_MAGIC, sizeof(PROGRAM_BINARY_MAGIC)) != 0) return false;
+
+    // a corrupt length mustn't get as far as allocating, compiling from source is the fallback
+    if (header.length == 0 || header.length != file_size - (std::streamoff) sizeof(header)) return false;
+
+    std::vector<char> binary(header.length);
+    if (!file.read(binary.data(), binary.size())) return false;
+
+    // the driver can still turn it down (after an update that kept the version string, say)
+    glProgramBinary(m_program_id, header.format, binary.data(), (GLsizei) binary.size());
 
-void ShaderProgram::load(const char *vertex_shader_file, const char *fragment_shader_file) {
-    
-    // create the vertex shader
-    m_vertex_shader = load_shader_from_file(vertex_shader_file, GL_VERTEX_SHADER);
-    // create the fragment shader
-    m_fragment_shader = load_shader_from_file(fragment_shader_file, GL_FRAGMENT_SHADER);
-    
-    // Create the final shader program from our vertex and fragment shaders
-    m_program_id = glCreateProgram();
-    glAttachShader(m_program_id, m_vertex_shader);
-    glAttachShader(m_program_id, m_fragment_shader);
-    glLinkProgram(m_program_id);
-    
     GLint link_success;
     glGetProgramiv(m_program_id, GL_LINK_STATUS, &link_success);
+    return link_success == GL_TRUE;
+}
+
+void ShaderProgram::save_program_binary(const std::string &path)
+{
+    GLint length = 0;
+    glGetProgramiv(m_program_id, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) return;
+
+    std::vector<char> binary(length);
+    GLenum format;
+    glGetProgramBinary(m_program_id, length, &length, &format, binary.data());
+
+    ProgramBinaryHeader header;
+    memcpy(header.magic, PROGRAM_BINARY_MAGIC, sizeof(PROGRAM_BINARY_MAGIC));
+    header.format = format;
+    header.length = (uint32_t) length;
+
+#ifdef _WINDOWS
+    _mkdir(SHADER_CACHE_DIRECTORY);
+#else
+    mkdir(SHADER_CACHE_DIRECTORY, 0755);
+#endif
+
+    // write to a temporary name and rename it over the old binary, so a crash never leaves half a file
+    std::string temporary_path = path + ".tmp";
+    {
+        std::ofstream file(temporary_path, std::ios::binary | std::ios::trunc);
+        file.write((const char *) &header, sizeof(header));
+        file.write(binary.data(), length);
+        if (!file)
+        {
+            file.close();
+            std::remove(temporary_path.c_str());
+            return;
+        }
+    }
+    std::remove(path.c_str());
+    std::rename(temporary_path.c_str(), path.c_str());
+}
+
+// nothing but comments may come before #version, so the preamble goes after it when there is one
+static std::string add_preamble(const std::string &source, const char *preamble)
+{
+    if (source.compare(0, 8, "#version") != 0) return preamble + source;
+
+    size_t line_end = source.find('\n');
+    if (line_end == std::string::npos) return source + "\n" + preamble;
+    return source.substr(0, line_end + 1) + preamble + source.substr(line_end + 1);
+}
+
+void ShaderProgram::load(const char *vertex_shader_file, const char *fragment_shader_file, const char *preamble) {
     
-    if(link_success == GL_FALSE)
+    PROFILE_ZONE("ShaderProgram::load");
+
+    std::string vertex_source   = add_preamble(read_shader_file(vertex_shader_file), preamble),
+                fragment_source = add_preamble(read_shader_file(fragment_shader_file), preamble);
+
+    m_program_id      = glCreateProgram();
+    m_vertex_shader   = 0;
+    m_fragment_shader = 0;
+
+    // try the binary the driver gave us last time before compiling anything
+    std::string binary_path = supports_program_binaries() ? program_binary_path(vertex_source, fragment_source) : "";
+    m_is_from_binary_cache = !binary_path.empty() && load_program_binary(binary_path);
+
+    if (!m_is_from_binary_cache)
     {
-        printf("Error linking shader program!\n");
+        // create the vertex shader
+        m_vertex_shader = load_shader_from_string(vertex_source, GL_VERTEX_SHADER);
+        // create the fragment shader
+        m_fragment_shader = load_shader_from_string(fragment_source, GL_FRAGMENT_SHADER);
+
+        // Create the final shader program from our vertex and fragment shaders
+        glAttachShader(m_program_id, m_vertex_shader);
+        glAttachShader(m_program_id, m_fragment_shader);
+        if (!binary_path.empty()) glProgramParameteri(m_program_id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        glLinkProgram(m_program_id);
+
+        GLint link_success;
+        glGetProgramiv(m_program_id, GL_LINK_STATUS, &link_success);
+
+        if(link_success == GL_FALSE)
+        {
+            printf("Error linking shader program!\n");
+        }
+        else if (!binary_path.empty())
+        {
+            save_program_binary(binary_path);
+        }
     }
     
     m_model_matrix_uniform      = glGetUniformLocation(m_program_id, "modelMatrix");
@@ -30,6 +175,8 @@ void ShaderProgram::load(const char *vertex_shader_file, const char *fragment_sh
     
     m_position_attribute  = glGetAttribLocation(m_program_id, "position");
     m_tex_coord_attribute = glGetAttribLocation(m_program_id, "texCoord");
+
+    forget_uniforms();
     
     set_colour(1.0f, 1.0f, 1.0f, 1.0f);
     
@@ -37,12 +184,13 @@ void ShaderProgram::load(const char *vertex_shader_file, const char *fragment_sh
 
 void ShaderProgram::cleanup()
 {
+    if (s_bound_program == m_program_id) s_bound_program = 0;
     glDeleteProgram(m_program_id);
     glDeleteShader(m_vertex_shader);
     glDeleteShader(m_fragment_shader);
 }
 
-GLuint ShaderProgram::load_shader_from_file(const std::string &shaderFile, GLenum type)
+std::string ShaderProgram::read_shader_file(const std::string &shaderFile)
 {
     //Open a file stream with the file name
     std::ifstream infile(shaderFile);
@@ -54,9 +202,7 @@ GLuint ShaderProgram::load_shader_from_file(const std::string &shaderFile, GLenu
     //Create a string buffer and stream the file to it
     std::stringstream buffer;
     buffer << infile.rdbuf();
-    
-    // Load the shader from the contents of the file
-    return load_shader_from_string(buffer.str(), type);
+    return buffer.str();
 }
 
 GLuint ShaderProgram::load_shader_from_string(const std::string &shaderContents, GLenum type)
@@ -88,26 +234,90 @@ GLuint ShaderProgram::load_shader_from_string(const std::string &shaderContents,
     return shaderID;
 }
 
-void ShaderProgram::set_colour(float red, float green, float blue, float alpha)
+bool ShaderProgram::bind_uniform_block(const char *block_name, GLuint binding_point)
 {
+    GLuint block_index = glGetUniformBlockIndex(m_program_id, block_name);
+    if (block_index == GL_INVALID_INDEX) return false;
+
+    glUniformBlockBinding(m_program_id, block_index, binding_point);
+    return true;
+}
+
+void ShaderProgram::forget_uniforms()
+{
+    m_has_model_matrix = m_has_projection_matrix = m_has_view_matrix = m_has_colour = false;
+}
+
+void ShaderProgram::use()
+{
+    if (s_bound_program == m_program_id)
+    {
+        s_stats.skipped++;
+        return;
+    }
+
     glUseProgram(m_program_id);
+    s_bound_program = m_program_id;
+    s_stats.issued++;
+}
+
+void ShaderProgram::set_colour(float red, float green, float blue, float alpha)
+{
+    glm::vec4 colour = glm::vec4(red, green, blue, alpha);
+    if (m_has_colour && m_colour == colour)
+    {
+        s_stats.skipped++;
+        return;
+    }
+
+    use();
     glUniform4f(m_colour_uniform, red, green, blue, alpha);
+    m_colour     = colour;
+    m_has_colour = true;
+    s_stats.issued++;
 }
 
 void ShaderProgram::set_view_matrix(const glm::mat4 &matrix)
 {
-    glUseProgram(m_program_id);
+    if (m_has_view_matrix && m_view_matrix == matrix)
+    {
+        s_stats.skipped++;
+        return;
+    }
+
+    use();
     glUniformMatrix4fv(m_view_matrix_uniform, 1, GL_FALSE, &matrix[0][0]);
+    m_view_matrix     = matrix;
+    m_has_view_matrix = true;
+    s_stats.issued++;
 }
 
 void ShaderProgram::set_model_matrix(const glm::mat4 &matrix)
 {
-    glUseProgram(m_program_id);
+    if (m_has_model_matrix && m_model_matrix == matrix)
+    {
+        s_stats.skipped++;
+        return;
+    }
+
+    use();
     glUniformMatrix4fv(m_model_matrix_uniform, 1, GL_FALSE, &matrix[0][0]);
+    m_model_matrix     = matrix;
+    m_has_model_matrix = true;
+    s_stats.issued++;
 }
 
 void ShaderProgram::set_projection_matrix(const glm::mat4 &matrix)
 {
-    glUseProgram(m_program_id);
+    if (m_has_projection_matrix && m_projection_matrix == matrix)
+    {
+        s_stats.skipped++;
+        return;
+    }
+
+    use();
     glUniformMatrix4fv(m_projection_matrix_uniform, 1, GL_FALSE, &matrix[0][0]);
+    m_projection_matrix     = matrix;
+    m_has_projection_matrix = true;
+    s_stats.issued++;
 }
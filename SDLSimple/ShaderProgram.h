@@ -4,20 +4,41 @@
     #include <GL/glew.h>
 #endif
 #define GL_GLEXT_PROTOTYPES 1
-#include <SDL_opengl.h>
+#if __has_include(<SDL_opengl.h>)
+    #include <SDL_opengl.h>
+#else
+    // building without SDL, see GLSupport.h
+    #include <GL/gl.h>
+    #include <GL/glext.h>
+#endif
+#include <cstdint>
 #include <string>
 #include <iostream>
 #include <fstream>
 #include <sstream>
 #include "glm/mat4x4.hpp"
+#include "glm/vec4.hpp"
+
+// how many glUseProgram / glUniform* calls actually went to the driver, and how many were dropped
+// because the program was already bound or the uniform already held that value
+struct ShaderCallStats
+{
+    size_t issued  = 0;
+    size_t skipped = 0;
+};
+
+// linked programs are kept here (per source + driver) so later launches can skip compiling
+constexpr char     SHADER_CACHE_DIRECTORY[] = "shader_cache";
+constexpr uint32_t SHADER_CACHE_VERSION     = 1;
 
 class ShaderProgram
 {
 private:
-    void cleanup();
-    
     GLuint load_shader_from_string(const std::string &shader_contents, GLenum shader_type);
-    GLuint load_shader_from_file(const std::string &shader_file, GLenum shader_type);
+    std::string read_shader_file(const std::string &shader_file);
+
+    bool load_program_binary(const std::string &path);
+    void save_program_binary(const std::string &path);
 
     GLuint m_program_id;
 
@@ -31,19 +52,51 @@ private:
 
     GLuint m_vertex_shader;
     GLuint m_fragment_shader;
+
+    bool m_is_from_binary_cache = false;
+
+    // last values uploaded to this program's uniforms, which GL keeps per program object
+    glm::mat4 m_model_matrix, m_projection_matrix, m_view_matrix;
+    glm::vec4 m_colour;
+    bool m_has_model_matrix = false, m_has_projection_matrix = false, m_has_view_matrix = false, m_has_colour = false;
+
+    void forget_uniforms();
+
+    // shared by every instance, there's only one current program per context
+    static GLuint          s_bound_program;
+    static ShaderCallStats s_stats;
     
 public:
 
-    void load(const char *vertex_shader_file, const char *fragment_shader_file);
+    // `preamble` goes in front of both sources (after their #version line, if they have one), for
+    // #defines and #extensions that pick a code path
+    void load(const char *vertex_shader_file, const char *fragment_shader_file, const char *preamble = "");
+    void cleanup();
+
+    // connects the named uniform block to a buffer binding point, false if the program has no such block
+    bool bind_uniform_block(const char *block_name, GLuint binding_point);
 
     void set_model_matrix(const glm::mat4 &matrix);
     void set_projection_matrix(const glm::mat4 &matrix);
     void set_view_matrix(const glm::mat4 &matrix);
     void set_colour(float red, float green, float blue, float alpha);
+
+    // binds the program unless it already is; use this instead of calling glUseProgram directly,
+    // otherwise the tracking above goes stale
+    void use();
+
+    static const ShaderCallStats &get_stats() { return s_stats; };
+    static void reset_stats() { s_stats = ShaderCallStats(); };
+
+    // forgets which program is bound; call it whenever a context is created or destroyed, since
+    // a new context starts with none bound and can hand out the same program ids again
+    static void reset_bound_program() { s_bound_program = 0; };
     
     GLuint const get_program_id()               const { return m_program_id;          };
     GLuint const get_position_attribute()       const { return m_position_attribute;  };
     GLuint const get_tex_coordinate_attribute() const { return m_tex_coord_attribute; };
+    bool   const is_from_binary_cache()         const { return m_is_from_binary_cache; };
+    GLint  const get_attribute_location(const char *name) const { return glGetAttribLocation(m_program_id, name); };
     
-    void set_program_id(GLuint program_id)                         { m_program_id = program_id;                   };
+    void set_program_id(GLuint program_id)                         { m_program_id = program_id; forget_uniforms(); };
 };
@@ -0,0 +1,255 @@
+#include <bit>
+#include <cstring>
+#include "Snapshot.h"
+
+// not glm's platform detection like CollisionKernel.cpp: GLM_FORCE_INTRINSICS would make the
+// vec3 constants in PongSim.h non-constexpr. Every x86-64 compiler has SSE2. GLM_FORCE_PURE
+// (-DPONG_SIMD=OFF) turns it off here too, so the scalar path gets built and tested somewhere
+#if (defined(__SSE2__) || defined(_M_X64)) && !defined(GLM_FORCE_PURE)
+    #include <emmintrin.h>
+    #define SNAPSHOT_SSE2 1
+#endif
+
+constexpr uint32_t FLAG_SINGLE_PLAYER = 1 << 0,
+                   FLAG_GAME_OVER     = 1 << 1;
+
+constexpr int WIDTH_BITS = 5; // a changed field's bit count minus one
+
+// header byte, change mask, then every field at full width, rounded up to the 8-byte stores
+// BitWriter makes
+static_assert((8 + SNAPSHOT_FIELD_COUNT + SNAPSHOT_FIELD_COUNT * (WIDTH_BITS + 32) + 63) / 64 * 8 <= SNAPSHOT_MAX_SIZE, "SNAPSHOT_MAX_SIZE is too small");
+
+// round to nearest without a branch (or std::lround, a libm call without -ffast-math): adding
+// 1.5 * 2^23 leaves no bits below the point, so the float add does the rounding. Good while
+// |value| stays under 2^22 / SNAPSHOT_UNITS_PER_ONE, i.e. hundreds of court widths.
+static uint32_t quantize(float value)
+{
+    constexpr float ROUNDING = 12582912.0f;
+    return (uint32_t) (int32_t) ((value * SNAPSHOT_UNITS_PER_ONE + ROUNDING) - ROUNDING);
+}
+
+static float dequantize(uint32_t value)
+{
+    return (float) (int32_t) value / SNAPSHOT_UNITS_PER_ONE;
+}
+
+#if SNAPSHOT_SSE2
+const char *snapshot_codec_name() { return "SSE2"; }
+#else
+const char *snapshot_codec_name() { return "scalar"; }
+#endif
+
+QuantizedSim quantize_sim(const PongSim &state)
+{
+    QuantizedSim quantized;
+    uint32_t *fields = quantized.fields;
+    fields[FIELD_BALL_X]            = quantize(state.ball_position.x);
+    fields[FIELD_BALL_Y]            = quantize(state.ball_position.y);
+    fields[FIELD_BALL_VELOCITY_X]   = quantize(state.ball_velocity.x);
+    fields[FIELD_BALL_VELOCITY_Y]   = quantize(state.ball_velocity.y);
+    fields[FIELD_BALL_SPEED]        = quantize(state.ball_speed);
+    fields[FIELD_CAT1_Y]            = quantize(state.cat1_position.y);
+    fields[FIELD_CAT2_Y]            = quantize(state.cat2_position.y);
+    fields[FIELD_AI_TARGET_Y]       = quantize(state.cat2_ai.target_y);
+    fields[FIELD_AI_REACTION]       = quantize(state.cat2_ai.reaction);
+    fields[FIELD_AI_BALL_DIRECTION] = quantize(state.cat2_ai.ball_direction);
+    fields[FIELD_FLAGS]             = (state.is_single_player_mode ? FLAG_SINGLE_PLAYER : 0) |
+                                      (state.is_game_over          ? FLAG_GAME_OVER     : 0);
+    return quantized;
+}
+
+PongSim dequantize_sim(const QuantizedSim &quantized)
+{
+    const uint32_t *fields = quantized.fields;
+    PongSim state = PongSim();
+    state.ball_position.x        = dequantize(fields[FIELD_BALL_X]);
+    state.ball_position.y        = dequantize(fields[FIELD_BALL_Y]);
+    state.ball_velocity.x        = dequantize(fields[FIELD_BALL_VELOCITY_X]);
+    state.ball_velocity.y        = dequantize(fields[FIELD_BALL_VELOCITY_Y]);
+    state.ball_speed             = dequantize(fields[FIELD_BALL_SPEED]);
+    state.cat1_position.y        = dequantize(fields[FIELD_CAT1_Y]);
+    state.cat2_position.y        = dequantize(fields[FIELD_CAT2_Y]);
+    state.cat2_ai.target_y       = dequantize(fields[FIELD_AI_TARGET_Y]);
+    state.cat2_ai.reaction       = dequantize(fields[FIELD_AI_REACTION]);
+    state.cat2_ai.ball_direction = dequantize(fields[FIELD_AI_BALL_DIRECTION]);
+    state.is_single_player_mode  = fields[FIELD_FLAGS] & FLAG_SINGLE_PLAYER;
+    state.is_game_over           = fields[FIELD_FLAGS] & FLAG_GAME_OVER;
+    return state;
+}
+
+// the difference from the baseline as an unsigned number that's small when the change is,
+// either way; the flags aren't a number, so just the bits that flipped. Unused with SSE2, which
+// does the same four fields at a time
+[[maybe_unused]] static uint32_t field_delta(int field, uint32_t value, uint32_t base)
+{
+    if (field == FIELD_FLAGS) return value ^ base;
+
+    int32_t difference = (int32_t) (value - base);
+    return ((uint32_t) difference << 1) ^ (uint32_t) (difference >> 31);
+}
+
+static uint32_t apply_delta(int field, uint32_t delta, uint32_t base)
+{
+    if (field == FIELD_FLAGS) return delta ^ base;
+    return base + ((delta >> 1) ^ (0u - (delta & 1)));
+}
+
+// Little-endian bit streams, moved along with whole unaligned 64-bit loads and stores rather
+// than a byte at a time; Mac, x86 and ARM are all little-endian. A field is at most 37 bits,
+// so with up to 7 bits already used of the first byte a single load always covers one.
+static_assert(std::endian::native == std::endian::little, "snapshot bit packing assumes a little-endian CPU");
+
+struct BitWriter
+{
+    unsigned char *out;
+    uint64_t bits  = 0;
+    int      count = 0; // in `bits`, always under 64
+
+    // value has to be 0 past its low `width` bits. A typical delta fits in `bits` whole, so
+    // usually all this does is a shift and an or
+    void write(uint64_t value, int width)
+    {
+        bits |= value << count;
+        if (count + width < 64)
+        {
+            count += width;
+            return;
+        }
+
+        memcpy(out, &bits, sizeof(bits));
+        out  += sizeof(bits);
+        bits  = value >> (64 - count); // count is at least 27 to have got here
+        count = count + width - 64;
+    }
+
+    // the end of the snapshot; the last store can write up to 7 bytes of junk past it, which
+    // is what SNAPSHOT_MAX_SIZE leaves room for
+    unsigned char *finish()
+    {
+        memcpy(out, &bits, sizeof(bits));
+        return out + (count + 7) / 8;
+    }
+};
+
+// the next 8 bytes as a little-endian number, or as many as there are with zeros after them.
+// Short tails are read with overlapping loads rather than a byte at a time (or copying the
+// snapshot somewhere with padding, whose stores the 8-byte loads then stall on)
+static uint64_t load_up_to_8(const unsigned char *at, size_t available)
+{
+    uint64_t bits = 0;
+    if (available >= 8)
+    {
+        memcpy(&bits, at, 8);
+    }
+    else if (available >= 4)
+    {
+        uint32_t low, high;
+        memcpy(&low, at, 4);
+        memcpy(&high, at + available - 4, 4);
+        bits = low | (uint64_t) high << (8 * (available - 4));
+    }
+    else if (available > 0)
+    {
+        bits = at[0] | (uint64_t) at[available / 2] << (8 * (available / 2)) | (uint64_t) at[available - 1] << (8 * (available - 1));
+    }
+    return bits;
+}
+
+struct BitReader
+{
+    const unsigned char *in;
+    size_t size;
+    size_t position = 0; // in bits
+
+    // past the end reads as zeros
+    uint64_t peek() const
+    {
+        size_t byte = position >> 3;
+        return load_up_to_8(in + byte, byte < size ? size - byte : 0) >> (position & 7);
+    }
+};
+
+// deltas[] for every field and a mask of the ones that aren't 0
+static uint32_t field_deltas(const uint32_t *fields, const uint32_t *base, uint32_t *deltas)
+{
+#if SNAPSHOT_SSE2
+    // the same as the scalar loop, four fields to a vector; only the last vector has the flags
+    const __m128i flags_lane = _mm_setr_epi32(0, 0, -1, 0);
+    static_assert(FIELD_FLAGS == 10 && SNAPSHOT_FIELD_COUNT + 1 == 12, "flags_lane is out of date");
+
+    uint32_t changed = 0;
+    for (int i = 0; i < SNAPSHOT_FIELD_COUNT + 1; i += 4)
+    {
+        __m128i value      = _mm_load_si128((const __m128i *) (fields + i)),
+                baseline   = _mm_load_si128((const __m128i *) (base + i)),
+                difference = _mm_sub_epi32(value, baseline),
+                delta      = _mm_xor_si128(_mm_slli_epi32(difference, 1), _mm_srai_epi32(difference, 31));
+
+        if (i == 8) delta = _mm_or_si128(_mm_andnot_si128(flags_lane, delta),
+                                         _mm_and_si128(flags_lane, _mm_xor_si128(value, baseline)));
+
+        _mm_store_si128((__m128i *) (deltas + i), delta);
+        int unchanged = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(delta, _mm_setzero_si128())));
+        changed |= (uint32_t) (~unchanged & 15) << i;
+    }
+    return changed;
+#else
+    uint32_t changed = 0;
+    for (int i = 0; i < SNAPSHOT_FIELD_COUNT; i++)
+    {
+        deltas[i] = field_delta(i, fields[i], base[i]);
+        changed  |= (deltas[i] != 0 ? 1u : 0u) << i;
+    }
+    return changed;
+#endif
+}
+
+size_t encode_snapshot(const QuantizedSim &state, const QuantizedSim *baseline, unsigned char *buffer)
+{
+    static const QuantizedSim NO_BASELINE;
+
+    alignas(16) uint32_t deltas[SNAPSHOT_FIELD_COUNT + 1];
+    uint32_t changed = field_deltas(state.fields, (baseline ? baseline : &NO_BASELINE)->fields, deltas);
+
+    BitWriter writer = { buffer };
+    writer.write((uint64_t) changed << 8 | SNAPSHOT_VERSION << 1 | (baseline ? 1 : 0), 8 + SNAPSHOT_FIELD_COUNT);
+
+    // only the changed fields, the 5-bit width and then the delta in that many bits
+    for (uint32_t remaining = changed; remaining; remaining &= remaining - 1)
+    {
+        int i     = std::countr_zero(remaining),
+            width = std::bit_width(deltas[i]);
+        writer.write((uint64_t) deltas[i] << WIDTH_BITS | (uint64_t) (width - 1), WIDTH_BITS + width);
+    }
+    return (size_t) (writer.finish() - buffer);
+}
+
+bool decode_snapshot(const unsigned char *data, size_t size, const QuantizedSim *baseline, QuantizedSim &state)
+{
+    if (size < 1 || size > SNAPSHOT_MAX_SIZE || data[0] >> 1 != SNAPSHOT_VERSION) return false;
+
+    bool is_delta = data[0] & 1;
+    if (is_delta && !baseline) return false;
+
+    QuantizedSim decoded = is_delta ? *baseline : QuantizedSim();
+
+    BitReader reader = { data, size };
+    uint32_t changed = (uint32_t) (reader.peek() >> 8) & ((1u << SNAPSHOT_FIELD_COUNT) - 1);
+    reader.position = 8 + SNAPSHOT_FIELD_COUNT;
+
+    for (uint32_t remaining = changed; remaining; remaining &= remaining - 1)
+    {
+        int      i     = std::countr_zero(remaining);
+        uint64_t bits  = reader.peek();
+        int      width = (int) (bits & ((1u << WIDTH_BITS) - 1)) + 1;
+
+        decoded.fields[i] = apply_delta(i, (uint32_t) ((bits >> WIDTH_BITS) & ((1ull << width) - 1)), decoded.fields[i]);
+        reader.position  += (size_t) (WIDTH_BITS + width);
+    }
+
+    // a truncated snapshot read zeros past its end
+    if (reader.position > size * 8) return false;
+
+    state = decoded;
+    return true;
+}
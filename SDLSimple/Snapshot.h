@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "PongSim.h"
+
+// Compact, versioned PongSim snapshots for sending to viewers. Every field is quantized to an
+// integer (positions, velocities and times in 1/1024ths, far below a pixel; flags as bits) and
+// written against a baseline snapshot: a bitmask of which fields differ, then for each of those
+// the zigzagged difference (the flags XOR'd) in as many bits as it needs, behind a 5-bit width.
+// From one tick to the next usually only the ball has moved, so a delta is around 5-8 bytes.
+//
+// Quantizing is lossy, so a decoded state is for showing, not for stepping on from where
+// bit-exact results matter; rollback and replays keep using PongSim copies and inputs. The z
+// components and the paddles' x offsets are always 0 in play and aren't carried.
+//
+// Encoding and decoding work on QuantizedSim so they're integer-only: a sender quantizes each
+// tick once, however many snapshots it makes of it, and keeps it as the next baseline; a
+// receiver keeps what it decoded as its baseline and dequantizes for drawing.
+
+enum SnapshotField
+{
+    FIELD_BALL_X,
+    FIELD_BALL_Y,
+    FIELD_BALL_VELOCITY_X,
+    FIELD_BALL_VELOCITY_Y,
+    FIELD_BALL_SPEED,
+    FIELD_CAT1_Y,
+    FIELD_CAT2_Y,
+    FIELD_AI_TARGET_Y,
+    FIELD_AI_REACTION,
+    FIELD_AI_BALL_DIRECTION,
+    FIELD_FLAGS,
+    SNAPSHOT_FIELD_COUNT
+};
+
+constexpr uint8_t SNAPSHOT_VERSION       = 1; // adding or reordering fields means a new one
+constexpr size_t  SNAPSHOT_MAX_SIZE      = 64; // the largest possible key frame, plus room for the encoder's 8-byte stores
+constexpr float   SNAPSHOT_UNITS_PER_ONE = 1024.0f;
+
+struct QuantizedSim
+{
+    alignas(16) uint32_t fields[SNAPSHOT_FIELD_COUNT + 1] = {}; // the last is always 0, it rounds them up to three SSE vectors
+};
+
+QuantizedSim quantize_sim(const PongSim &state);
+PongSim dequantize_sim(const QuantizedSim &quantized);
+
+// bytes of snapshot written to `buffer`, which has to hold SNAPSHOT_MAX_SIZE: a few bytes past
+// the snapshot's end get overwritten too. The baseline has to be one the receiver has (what it
+// decoded from an earlier snapshot); which one is up to the transport. A null baseline makes a
+// key frame, which needs none to decode.
+size_t encode_snapshot(const QuantizedSim &state, const QuantizedSim *baseline, unsigned char *buffer);
+
+// false, with `state` untouched, for a truncated snapshot, another version, or a delta without
+// a baseline to apply it to
+bool decode_snapshot(const unsigned char *data, size_t size, const QuantizedSim *baseline, QuantizedSim &state);
+
+// "SSE2" or "scalar", depending on what encode_snapshot() was compiled for
+const char *snapshot_codec_name();
+
+// whether the snapshot needs a baseline to decode
+inline bool is_delta_snapshot(const unsigned char *data, size_t size) { return size > 0 && (data[0] & 1); }
@@ -0,0 +1,184 @@
+#define GL_SILENCE_DEPRECATION
+
+#include <cstddef>
+#include "SpriteBatch.h"
+#include "GLSupport.h"
+
+// unit quad, two triangles, same layout render() used to rebuild every frame
+static const float QUAD_VERTICES[] =
+{
+    // position       // texture coordinates
+    -0.5f, -0.5f,     0.0f, 1.0f,
+     0.5f, -0.5f,     1.0f, 1.0f,
+     0.5f,  0.5f,     1.0f, 0.0f,
+    -0.5f, -0.5f,     0.0f, 1.0f,
+     0.5f,  0.5f,     1.0f, 0.0f,
+    -0.5f,  0.5f,     0.0f, 0.0f,
+};
+
+constexpr GLsizei QUAD_VERTEX_COUNT = 6,
+                  QUAD_STRIDE       = 4 * sizeof(float);
+
+void SpriteBatch::initialise(ShaderProgram &program, size_t capacity)
+{
+    m_program = &program;
+
+    m_position_attribute  = program.get_position_attribute();
+    m_tex_coord_attribute = program.get_tex_coordinate_attribute();
+    m_rect_attribute      = program.get_attribute_location("instanceRect");
+    m_uv_attribute        = program.get_attribute_location("instanceUV");
+
+    // glVertexAttribDivisor and glDrawArraysInstanced are both core from GL 3.3
+    m_is_instanced = gl_version_at_least(3, 3);
+    m_has_vao      = gl_version_at_least(3, 0) || gl_has_extension("GL_ARB_vertex_array_object");
+
+    glGenBuffers(1, &m_quad_vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, m_quad_vbo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(QUAD_VERTICES), QUAD_VERTICES, GL_STATIC_DRAW);
+
+    m_capacity = capacity;
+    glGenBuffers(1, &m_instance_vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, m_instance_vbo);
+    glBufferData(GL_ARRAY_BUFFER, m_capacity * sizeof(Instance), NULL, GL_STREAM_DRAW);
+
+    if (m_has_vao)
+    {
+        // everything flush() used to set up and tear down every frame, recorded once
+        glGenVertexArrays(1, &m_vao);
+        glBindVertexArray(m_vao);
+        enable_attributes();
+        glBindVertexArray(0);
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    m_instances.reserve(capacity);
+    m_runs.reserve(capacity);
+}
+
+void SpriteBatch::cleanup()
+{
+    if (m_has_vao) glDeleteVertexArrays(1, &m_vao);
+    glDeleteBuffers(1, &m_quad_vbo);
+    glDeleteBuffers(1, &m_instance_vbo);
+    m_vao = m_quad_vbo = m_instance_vbo = 0;
+}
+
+void SpriteBatch::enable_attributes()
+{
+    // static quad
+    glBindBuffer(GL_ARRAY_BUFFER, m_quad_vbo);
+    glVertexAttribPointer(m_position_attribute, 2, GL_FLOAT, GL_FALSE, QUAD_STRIDE, (const void *) 0);
+    glEnableVertexAttribArray(m_position_attribute);
+    glVertexAttribPointer(m_tex_coord_attribute, 2, GL_FLOAT, GL_FALSE, QUAD_STRIDE, (const void *) (2 * sizeof(float)));
+    glEnableVertexAttribArray(m_tex_coord_attribute);
+
+    if (m_is_instanced)
+    {
+        // orphaning the instance buffer in flush() keeps its name, so these stay valid
+        glBindBuffer(GL_ARRAY_BUFFER, m_instance_vbo);
+        point_instance_attributes(0);
+        glEnableVertexAttribArray(m_rect_attribute);
+        glEnableVertexAttribArray(m_uv_attribute);
+        glVertexAttribDivisor(m_rect_attribute, 1);
+        glVertexAttribDivisor(m_uv_attribute, 1);
+    }
+}
+
+void SpriteBatch::disable_attributes()
+{
+    if (m_is_instanced)
+    {
+        glVertexAttribDivisor(m_rect_attribute, 0);
+        glVertexAttribDivisor(m_uv_attribute, 0);
+        glDisableVertexAttribArray(m_rect_attribute);
+        glDisableVertexAttribArray(m_uv_attribute);
+    }
+    glDisableVertexAttribArray(m_position_attribute);
+    glDisableVertexAttribArray(m_tex_coord_attribute);
+}
+
+// expects the instance buffer to be bound
+void SpriteBatch::point_instance_attributes(size_t first_instance)
+{
+    size_t offset = first_instance * sizeof(Instance);
+    glVertexAttribPointer(m_rect_attribute, 4, GL_FLOAT, GL_FALSE, sizeof(Instance),
+                          (const void *) (offset + offsetof(Instance, rect)));
+    glVertexAttribPointer(m_uv_attribute, 4, GL_FLOAT, GL_FALSE, sizeof(Instance),
+                          (const void *) (offset + offsetof(Instance, uv)));
+    m_instance_offset = first_instance;
+}
+
+void SpriteBatch::begin()
+{
+    m_instances.clear();
+    m_runs.clear();
+}
+
+void SpriteBatch::draw(GLuint texture_id, const glm::vec3 &position, const glm::vec3 &scale, const glm::vec4 &uv_rect)
+{
+    m_instances.push_back({ { position.x, position.y, scale.x, scale.y },
+                            { uv_rect.x, uv_rect.y, uv_rect.z, uv_rect.w } });
+
+    // keep extending the current run while the texture doesn't change
+    if (!m_runs.empty() && m_runs.back().texture_id == texture_id) {
+        m_runs.back().count++;
+    } else {
+        m_runs.push_back({ texture_id, m_instances.size() - 1, 1 });
+    }
+}
+
+void SpriteBatch::flush()
+{
+    m_draw_calls = 0;
+    if (m_instances.empty()) return;
+
+    m_program->use();
+
+    if (m_has_vao) {
+        glBindVertexArray(m_vao);
+    } else {
+        enable_attributes();
+    }
+
+    if (m_is_instanced)
+    {
+        // stream this frame's instances, orphaning last frame's storage so we never wait on the GPU
+        glBindBuffer(GL_ARRAY_BUFFER, m_instance_vbo);
+        if (m_instances.size() > m_capacity) m_capacity = m_instances.size() * 2;
+        glBufferData(GL_ARRAY_BUFFER, m_capacity * sizeof(Instance), NULL, GL_STREAM_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, m_instances.size() * sizeof(Instance), m_instances.data());
+
+        for (const Run &run : m_runs)
+        {
+            // only the runs after the first need the instance attributes moved to their slice
+            if (run.first != m_instance_offset) point_instance_attributes(run.first);
+
+            glBindTexture(GL_TEXTURE_2D, run.texture_id);
+            glDrawArraysInstanced(GL_TRIANGLES, 0, QUAD_VERTEX_COUNT, (GLsizei) run.count);
+            m_draw_calls++;
+        }
+    }
+    else
+    {
+        // no instancing: the instance attributes become constant vertex attributes, one draw each
+        for (const Run &run : m_runs)
+        {
+            glBindTexture(GL_TEXTURE_2D, run.texture_id);
+            for (size_t i = run.first; i < run.first + run.count; i++)
+            {
+                glVertexAttrib4fv(m_rect_attribute, m_instances[i].rect);
+                glVertexAttrib4fv(m_uv_attribute, m_instances[i].uv);
+                glDrawArrays(GL_TRIANGLES, 0, QUAD_VERTEX_COUNT);
+                m_draw_calls++;
+            }
+        }
+    }
+
+    if (m_has_vao) {
+        glBindVertexArray(0);
+    } else {
+        disable_attributes();
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
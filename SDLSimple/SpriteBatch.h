@@ -0,0 +1,70 @@
+#pragma once
+
+#include <vector>
+#include "glm/vec3.hpp"
+#include "glm/vec4.hpp"
+#include "ShaderProgram.h"
+
+// Collects translate + scale sprites for a frame and draws them with as few GL calls as
+// possible: the unit quad lives in a static VBO, per-sprite transforms and UV rects are
+// streamed into an instance buffer, and each run of sprites sharing a texture is a single
+// glDrawArraysInstanced. Sprites are drawn in the order they were added so blending still works.
+// All the attribute setup is recorded once in a VAO (which core profiles require anyway), so a
+// flush only uploads the instances and draws.
+// Needs shaders/vertex_instanced.glsl; falls back to one draw per sprite below GL 3.3, and to
+// setting the attributes up on every flush below GL 3.0.
+class SpriteBatch
+{
+public:
+    static constexpr size_t DEFAULT_CAPACITY = 256;
+
+    void initialise(ShaderProgram &program, size_t capacity = DEFAULT_CAPACITY);
+    void cleanup();
+
+    void begin();
+    void draw(GLuint texture_id, const glm::vec3 &position, const glm::vec3 &scale,
+              const glm::vec4 &uv_rect = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f));
+    void flush();
+
+    // GL draw calls made by the last flush()
+    size_t get_draw_calls() const { return m_draw_calls; }
+    bool   is_instanced()   const { return m_is_instanced; }
+
+private:
+    void enable_attributes();
+    void disable_attributes();
+    void point_instance_attributes(size_t first_instance);
+
+    struct Instance
+    {
+        float rect[4]; // centre x, centre y, scale x, scale y
+        float uv[4];   // u, v, width, height
+    };
+
+    struct Run
+    {
+        GLuint texture_id;
+        size_t first, count;
+    };
+
+    ShaderProgram *m_program = nullptr;
+
+    std::vector<Instance> m_instances;
+    std::vector<Run>      m_runs;
+
+    GLuint m_vao          = 0;
+    GLuint m_quad_vbo     = 0;
+    GLuint m_instance_vbo = 0;
+    size_t m_capacity     = 0; // instances the instance buffer currently has room for
+
+    GLint m_position_attribute  = -1;
+    GLint m_tex_coord_attribute = -1;
+    GLint m_rect_attribute      = -1;
+    GLint m_uv_attribute        = -1;
+
+    size_t m_instance_offset = 0; // instance the rect/uv attributes currently start at
+
+    bool   m_has_vao      = false;
+    bool   m_is_instanced = false;
+    size_t m_draw_calls   = 0;
+};
@@ -0,0 +1,138 @@
+#define GL_SILENCE_DEPRECATION
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include "StatsHud.h"
+
+// every glyph is 3x5, one bit per pixel, rows top to bottom and the left pixel in the high bit
+struct Glyph
+{
+    char          character;
+    unsigned char rows[5];
+};
+
+static const Glyph GLYPHS[] =
+{
+    { '0', { 7, 5, 5, 5, 7 } }, { '1', { 2, 6, 2, 2, 7 } }, { '2', { 7, 1, 7, 4, 7 } },
+    { '3', { 7, 1, 7, 1, 7 } }, { '4', { 5, 5, 7, 1, 1 } }, { '5', { 7, 4, 7, 1, 7 } },
+    { '6', { 7, 4, 7, 5, 7 } }, { '7', { 7, 1, 1, 1, 1 } }, { '8', { 7, 5, 7, 5, 7 } },
+    { '9', { 7, 5, 7, 1, 7 } }, { '.', { 0, 0, 0, 0, 2 } }, { 'a', { 2, 5, 7, 5, 5 } },
+    { 'c', { 7, 4, 4, 4, 7 } }, { 'i', { 7, 2, 2, 2, 7 } }, { 'm', { 5, 7, 7, 5, 5 } },
+    { 'p', { 7, 5, 7, 4, 4 } }, { 's', { 3, 4, 2, 1, 6 } }, { 'u', { 5, 5, 5, 5, 7 } },
+    { 'w', { 5, 5, 7, 7, 5 } }, { 'x', { 5, 5, 2, 5, 5 } },
+};
+
+constexpr int GLYPH_COUNT  = sizeof(GLYPHS) / sizeof(GLYPHS[0]),
+              GLYPH_WIDTH  = 3,
+              GLYPH_HEIGHT = 5,
+              CELL_WIDTH   = GLYPH_WIDTH + 1, // a transparent gap keeps nearest sampling off the neighbours
+              CELL_HEIGHT  = GLYPH_HEIGHT + 1,
+              PANEL_CELL   = GLYPH_COUNT,     // a solid cell after the glyphs, for the backdrop
+              FONT_WIDTH   = (GLYPH_COUNT + 1) * CELL_WIDTH,
+              FONT_HEIGHT  = 2 * CELL_HEIGHT; // normal glyphs on the first row, warning ones below
+
+constexpr unsigned char TEXT_COLOUR[4]    = { 255, 255, 255, 255 },
+                        WARNING_COLOUR[4] = { 255, 90, 80, 255 },
+                        PANEL_COLOUR[4]   = { 0, 0, 0, 170 };
+
+constexpr int   HUD_PIXELS_PER_TEXEL = 2,
+                COLUMN_CHARACTERS    = 6;
+constexpr float FRAME_BUDGET_MS      = 1000.0f / 60.0f;
+
+static int glyph_index(char character)
+{
+    for (int i = 0; i < GLYPH_COUNT; i++) if (GLYPHS[i].character == character) return i;
+    return -1;
+}
+
+void StatsHud::initialise()
+{
+    std::vector<unsigned char> pixels(FONT_WIDTH * FONT_HEIGHT * 4, 0);
+    auto set_pixel = [&](int x, int y, const unsigned char *colour) { memcpy(&pixels[(y * FONT_WIDTH + x) * 4], colour, 4); };
+
+    for (int row = 0; row < 2; row++)
+    {
+        const unsigned char *colour = row == 0 ? TEXT_COLOUR : WARNING_COLOUR;
+        for (int i = 0; i < GLYPH_COUNT; i++)
+        {
+            for (int y = 0; y < GLYPH_HEIGHT; y++)
+            {
+                for (int x = 0; x < GLYPH_WIDTH; x++)
+                {
+                    if (GLYPHS[i].rows[y] & (4 >> x)) set_pixel(i * CELL_WIDTH + x, row * CELL_HEIGHT + y, colour);
+                }
+            }
+        }
+    }
+    for (int y = 0; y < GLYPH_HEIGHT; y++)
+    {
+        for (int x = 0; x < GLYPH_WIDTH; x++) set_pixel(PANEL_CELL * CELL_WIDTH + x, y, PANEL_COLOUR);
+    }
+
+    glGenTextures(1, &m_texture_id);
+    glBindTexture(GL_TEXTURE_2D, m_texture_id);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, FONT_WIDTH, FONT_HEIGHT, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+}
+
+void StatsHud::cleanup()
+{
+    glDeleteTextures(1, &m_texture_id);
+    m_texture_id = 0;
+}
+
+static glm::vec4 cell_uv(int column, int row)
+{
+    return glm::vec4((float) (column * CELL_WIDTH) / FONT_WIDTH, (float) (row * CELL_HEIGHT) / FONT_HEIGHT,
+                     (float) GLYPH_WIDTH / FONT_WIDTH, (float) GLYPH_HEIGHT / FONT_HEIGHT);
+}
+
+void StatsHud::draw_text(SpriteBatch &batch, const char *text, bool is_warning, glm::vec2 at, const glm::vec2 &texel_size)
+{
+    glm::vec3 scale = glm::vec3(GLYPH_WIDTH * texel_size.x, GLYPH_HEIGHT * texel_size.y, 0.0f);
+
+    for (const char *c = text; *c != '\0'; c++, at.x += CELL_WIDTH * texel_size.x)
+    {
+        int glyph = glyph_index(*c);
+        if (glyph < 0) continue; // spaces and anything the font doesn't have
+
+        // `at` is the glyph's top-left corner, sprites are positioned by their centre
+        glm::vec3 centre = glm::vec3(at.x + scale.x * 0.5f, at.y - scale.y * 0.5f, 0.0f);
+        batch.draw(m_texture_id, centre, scale, cell_uv(glyph, is_warning ? 1 : 0));
+    }
+}
+
+void StatsHud::draw(SpriteBatch &batch, const FrameStats &stats, const glm::vec2 &top_left, const glm::vec2 &pixel_size)
+{
+    if (!m_is_visible) return;
+
+    glm::vec2 texel_size  = pixel_size * (float) HUD_PIXELS_PER_TEXEL;
+    glm::vec2 cell_size   = glm::vec2(CELL_WIDTH, CELL_HEIGHT) * texel_size;
+    glm::vec2 table_size  = glm::vec2(5 * COLUMN_CHARACTERS + 2, FrameStats::SERIES_COUNT + 2) * cell_size;
+
+    // the backdrop is the panel cell stretched over the whole table
+    glm::vec3 panel_centre = glm::vec3(top_left.x + table_size.x * 0.5f, top_left.y - table_size.y * 0.5f, 0.0f);
+    batch.draw(m_texture_id, panel_centre, glm::vec3(table_size, 0.0f), cell_uv(PANEL_CELL, 0));
+
+    glm::vec2 line = top_left + glm::vec2(cell_size.x, -cell_size.y * 0.5f);
+    draw_text(batch, "         p50   p95   p99   max", false, line, texel_size);
+
+    for (int series = 0; series < FrameStats::SERIES_COUNT; series++)
+    {
+        line.y -= cell_size.y;
+        draw_text(batch, FRAME_STATS_SERIES_NAMES[series], false, line, texel_size);
+
+        FrameStats::Percentiles percentiles = stats.get_percentiles((FrameStats::Series) series);
+        float values[4] = { percentiles.p50, percentiles.p95, percentiles.p99, percentiles.max };
+        for (int column = 0; column < 4; column++)
+        {
+            char text[16];
+            snprintf(text, sizeof(text), "%6.2f", values[column]);
+
+            glm::vec2 at = line + glm::vec2((column + 1) * COLUMN_CHARACTERS * cell_size.x, 0.0f);
+            draw_text(batch, text, values[column] > FRAME_BUDGET_MS, at, texel_size);
+        }
+    }
+}
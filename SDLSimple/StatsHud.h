@@ -0,0 +1,28 @@
+#pragma once
+
+#include "glm/vec2.hpp"
+#include "FrameStats.h"
+#include "SpriteBatch.h"
+
+// Draws a FrameStats table (p50/p95/p99/max in ms per series) as sprites through a SpriteBatch,
+// using a tiny 3x5 pixel font that's generated at startup, so no extra assets or shaders.
+// Values over the frame budget come out red.
+class StatsHud
+{
+public:
+    void initialise();
+    void cleanup();
+
+    // queues the table with its top-left corner at `top_left`; `pixel_size` is one screen pixel in
+    // world units. Call between batch.begin() and batch.flush().
+    void draw(SpriteBatch &batch, const FrameStats &stats, const glm::vec2 &top_left, const glm::vec2 &pixel_size);
+
+    void toggle()           { m_is_visible = !m_is_visible; }
+    bool is_visible() const { return m_is_visible; }
+
+private:
+    void draw_text(SpriteBatch &batch, const char *text, bool is_warning, glm::vec2 at, const glm::vec2 &texel_size);
+
+    GLuint m_texture_id = 0;
+    bool   m_is_visible = false;
+};
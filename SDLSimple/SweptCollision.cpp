@@ -0,0 +1,108 @@
+#include "SweptCollision.h"
+#include "PongRules.h"
+
+static_assert(BALL_TOP_LIMIT    == COURT_TOP - BALL_HALF_SIZE, "contact limits out of date");
+static_assert(BALL_BOTTOM_LIMIT == COURT_BOTTOM + BALL_HALF_SIZE, "contact limits out of date");
+static_assert(CAT1_CONTACT_X    == CAT1_X + PADDLE_HALF_WIDTH + BALL_HALF_SIZE, "contact limits out of date");
+static_assert(CAT2_CONTACT_X    == CAT2_X - PADDLE_HALF_WIDTH - BALL_HALF_SIZE, "contact limits out of date");
+
+enum ImpactAxis { NO_IMPACT, IMPACT_X, IMPACT_Y };
+
+bool sweep_ball(float &x, float &y, float &velocity_x, float &velocity_y,
+                float speed, float cat1_y, float cat2_y, float delta_time)
+{
+    float remaining = delta_time;
+
+    for (int bounce = 0; bounce < MAX_BOUNCES_PER_STEP && remaining > 0.0f; bounce++)
+    {
+        float dx = velocity_x * speed,
+              dy = velocity_y * speed;
+
+        // where the ball ends up if nothing is in the way, same arithmetic as the plain step
+        float end_x = x + dx * remaining,
+              end_y = y + dy * remaining;
+
+        float      impact_time = remaining;
+        ImpactAxis impact_axis = NO_IMPACT;
+        float      impact_at   = 0.0f;
+
+        // top and bottom walls
+        if (dy > 0.0f && end_y > BALL_TOP_LIMIT)
+        {
+            impact_time = (BALL_TOP_LIMIT - y) / dy;
+            impact_axis = IMPACT_Y;
+            impact_at   = BALL_TOP_LIMIT;
+        }
+        else if (dy < 0.0f && end_y < BALL_BOTTOM_LIMIT)
+        {
+            impact_time = (BALL_BOTTOM_LIMIT - y) / dy;
+            impact_axis = IMPACT_Y;
+            impact_at   = BALL_BOTTOM_LIMIT;
+        }
+
+        // paddle faces, only counted when the ball is still in front of the face and reaches it
+        // with its centre between the paddle's top and bottom
+        float face_time = remaining, face_x = 0.0f, paddle_y = 0.0f;
+        bool  crosses_face = false;
+
+        if (dx < 0.0f && x >= CAT1_CONTACT_X && end_x < CAT1_CONTACT_X)
+        {
+            face_time = (CAT1_CONTACT_X - x) / dx;
+            face_x    = CAT1_CONTACT_X;
+            paddle_y  = cat1_y;
+            crosses_face = true;
+        }
+        else if (dx > 0.0f && x <= CAT2_CONTACT_X && end_x > CAT2_CONTACT_X)
+        {
+            face_time = (CAT2_CONTACT_X - x) / dx;
+            face_x    = CAT2_CONTACT_X;
+            paddle_y  = cat2_y;
+            crosses_face = true;
+        }
+
+        if (crosses_face && face_time < impact_time)
+        {
+            float y_at_face = y + dy * face_time;
+            if (y_at_face < paddle_y + PADDLE_HALF_HEIGHT && y_at_face > paddle_y - PADDLE_HALF_HEIGHT)
+            {
+                impact_time = face_time;
+                impact_axis = IMPACT_X;
+                impact_at   = face_x;
+            }
+        }
+
+        if (impact_axis == NO_IMPACT)
+        {
+            x = end_x;
+            y = end_y;
+            remaining = 0.0f;
+            break;
+        }
+
+        if (impact_time < 0.0f) impact_time = 0.0f; // ball was already past the limit, bounce right away
+
+        // land exactly on the contact line so rounding can't carry the ball through it
+        if (impact_axis == IMPACT_X)
+        {
+            x = impact_at;
+            y += dy * impact_time;
+            velocity_x = -velocity_x;
+        }
+        else
+        {
+            x += dx * impact_time;
+            y = impact_at;
+            velocity_y = -velocity_y;
+        }
+        remaining -= impact_time;
+    }
+
+    // out of bounces, finish the step in a straight line
+    if (remaining > 0.0f)
+    {
+        x += velocity_x * speed * remaining;
+        y += velocity_y * speed * remaining;
+    }
+
+    return x + BALL_HALF_SIZE > COURT_RIGHT || x - BALL_HALF_SIZE < COURT_LEFT;
+}
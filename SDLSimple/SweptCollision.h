@@ -0,0 +1,21 @@
+#pragma once
+
+// Continuous collision for the ball. Instead of moving the whole step and then checking for
+// overlap (which lets a fast ball skip straight past a paddle on a long step), the ball is
+// walked from impact to impact: paddle faces and the top/bottom walls are solved for their
+// exact time of impact and the ball reflects there, as many times as the step needs.
+// Glm-free so the SIMD collision kernel can call it for the balls it can't handle on its own.
+
+// how far the ball centre can travel before its edge touches something
+constexpr float BALL_TOP_LIMIT    = 3.25f,  // COURT_TOP - BALL_HALF_SIZE
+                BALL_BOTTOM_LIMIT = -3.25f, // COURT_BOTTOM + BALL_HALF_SIZE
+                CAT1_CONTACT_X    = -3.0f,  // CAT1_X + PADDLE_HALF_WIDTH + BALL_HALF_SIZE
+                CAT2_CONTACT_X    =  3.0f;  // CAT2_X - PADDLE_HALF_WIDTH - BALL_HALF_SIZE
+
+// upper bound on bounces resolved within a single step, anything left over just moves straight
+constexpr int MAX_BOUNCES_PER_STEP = 8;
+
+// moves the ball for delta_time with both paddles (centre y values) held still, reflecting it
+// off paddle faces and walls. Returns true if the ball ended the step out of the court.
+bool sweep_ball(float &x, float &y, float &velocity_x, float &velocity_y,
+                float speed, float cat1_y, float cat2_y, float delta_time);
@@ -0,0 +1,179 @@
+#define GL_SILENCE_DEPRECATION
+
+#include <algorithm>
+#include <cstring>
+#include "TextureAtlas.h"
+
+constexpr int MIN_ATLAS_SIZE = 256;
+
+int TextureAtlas::add(const Image &image)
+{
+    m_images.push_back(&image);
+    m_uv_rects.push_back(glm::vec4(0.0f, 0.0f, 1.0f, 1.0f));
+    return (int) m_images.size() - 1;
+}
+
+bool TextureAtlas::find_position(const std::vector<Segment> &skyline, int atlas_width, int atlas_height,
+                                 int width, int height, int &best_x, int &best_y, size_t &best_index)
+{
+    bool found = false;
+    int  best_top = 0;
+
+    for (size_t i = 0; i < skyline.size(); i++)
+    {
+        int x = skyline[i].x;
+        if (x + width > atlas_width) break;
+
+        // the sprite rests on the highest segment underneath it
+        int y = 0, covered = 0;
+        for (size_t j = i; j < skyline.size() && covered < width; j++)
+        {
+            y = std::max(y, skyline[j].y);
+            covered = skyline[j].x + skyline[j].width - x;
+        }
+        if (y + height > atlas_height) continue;
+
+        if (!found || y + height < best_top || (y + height == best_top && x < best_x))
+        {
+            found      = true;
+            best_top   = y + height;
+            best_x     = x;
+            best_y     = y;
+            best_index = i;
+        }
+    }
+    return found;
+}
+
+void TextureAtlas::place(std::vector<Segment> &skyline, size_t index, int x, int y, int width, int height)
+{
+    skyline.insert(skyline.begin() + index, { x, y + height, width });
+
+    // shrink or drop the segments the new one now covers
+    int right = x + width;
+    for (size_t i = index + 1; i < skyline.size(); )
+    {
+        Segment &segment = skyline[i];
+        if (segment.x >= right) break;
+
+        int overlap = right - segment.x;
+        if (overlap >= segment.width) {
+            skyline.erase(skyline.begin() + i);
+        } else {
+            segment.x     += overlap;
+            segment.width -= overlap;
+            break;
+        }
+    }
+
+    // merge neighbours at the same height
+    for (size_t i = 0; i + 1 < skyline.size(); )
+    {
+        if (skyline[i].y == skyline[i + 1].y) {
+            skyline[i].width += skyline[i + 1].width;
+            skyline.erase(skyline.begin() + i + 1);
+        } else {
+            i++;
+        }
+    }
+}
+
+bool TextureAtlas::pack(int atlas_width, int atlas_height, std::vector<Placement> &placements) const
+{
+    // tallest first packs noticeably tighter for skyline packers
+    std::vector<size_t> order(m_images.size());
+    for (size_t i = 0; i < order.size(); i++) order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [this](size_t a, size_t b) {
+        return m_images[a]->height > m_images[b]->height;
+    });
+
+    std::vector<Segment> skyline = { { 0, 0, atlas_width } };
+    placements.assign(m_images.size(), { 0, 0 });
+
+    for (size_t index : order)
+    {
+        int cell_width  = m_images[index]->width  + 2 * EXTRUDE,
+            cell_height = m_images[index]->height + 2 * EXTRUDE;
+
+        int x = 0, y = 0;
+        size_t segment = 0;
+        if (!find_position(skyline, atlas_width, atlas_height, cell_width, cell_height, x, y, segment)) return false;
+
+        place(skyline, segment, x, y, cell_width, cell_height);
+        placements[index] = { x + EXTRUDE, y + EXTRUDE };
+    }
+    return true;
+}
+
+bool TextureAtlas::build(int max_size)
+{
+    std::vector<Placement> placements;
+
+    // grow width and height in turn so the atlas stays roughly square, the last step of each
+    // stopping at max_size (which needn't be a power of two)
+    int width  = std::min(MIN_ATLAS_SIZE, max_size),
+        height = width;
+    while (!pack(width, height, placements))
+    {
+        if (width >= max_size && height >= max_size) return false;
+
+        if ((width <= height || height >= max_size) && width < max_size) width = std::min(width * 2, max_size);
+        else height = std::min(height * 2, max_size);
+    }
+
+    m_width  = width;
+    m_height = height;
+    m_pixels.width  = width;
+    m_pixels.height = height;
+    m_pixels.pixels.assign((size_t) width * height * IMAGE_CHANNELS, 0);
+
+    size_t atlas_stride = (size_t) width * IMAGE_CHANNELS;
+
+    for (size_t i = 0; i < m_images.size(); i++)
+    {
+        const Image &image = *m_images[i];
+        const Placement &at = placements[i];
+        size_t row_bytes = (size_t) image.width * IMAGE_CHANNELS;
+
+        // copy the sprite, plus its edge columns and rows stretched out into the extrude border
+        for (int row = -EXTRUDE; row < image.height + EXTRUDE; row++)
+        {
+            int source_row = std::min(std::max(row, 0), image.height - 1);
+            const unsigned char *source = image.data() + source_row * row_bytes;
+            unsigned char *destination  = &m_pixels.pixels[(at.y + row) * atlas_stride + (size_t) at.x * IMAGE_CHANNELS];
+
+            memcpy(destination, source, row_bytes);
+            for (int e = 1; e <= EXTRUDE; e++)
+            {
+                memcpy(destination - e * IMAGE_CHANNELS, source, IMAGE_CHANNELS);
+                memcpy(destination + row_bytes + (e - 1) * IMAGE_CHANNELS, source + row_bytes - IMAGE_CHANNELS, IMAGE_CHANNELS);
+            }
+        }
+
+        m_uv_rects[i] = glm::vec4((float) at.x / width, (float) at.y / height,
+                                  (float) image.width / width, (float) image.height / height);
+    }
+
+    m_images.clear(); // done with the caller's images
+    return true;
+}
+
+GLuint TextureAtlas::upload()
+{
+    glGenTextures(1, &m_texture_id);
+    glBindTexture(GL_TEXTURE_2D, m_texture_id);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, m_width, m_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, m_pixels.pixels.data());
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    // the GPU has its copy now
+    m_pixels = Image();
+    return m_texture_id;
+}
+
+void TextureAtlas::cleanup()
+{
+    glDeleteTextures(1, &m_texture_id);
+    m_texture_id = 0;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <vector>
+#include "glm/vec4.hpp"
+#include "ShaderProgram.h"
+#include "Image.h"
+
+// Packs several sprites into one texture at load time so a whole frame can be drawn
+// with a single texture bind. Uses a skyline bottom-left packer: sprites go in tallest
+// first, each one at the spot that keeps the skyline lowest.
+class TextureAtlas
+{
+public:
+    // every sprite gets this many pixels of its own edge copied around it, so sampling
+    // right at a sprite's border never picks up its neighbour
+    static constexpr int EXTRUDE = 1;
+
+    // returns the sprite's index for get_uv_rect(); the image must stay alive until build()
+    int add(const Image &image);
+
+    // tries power-of-two sizes up to max_size; false if the sprites don't fit
+    bool build(int max_size);
+
+    GLuint upload();
+    void   cleanup();
+
+    // u, v, width, height of the sprite inside the atlas, the layout SpriteBatch::draw wants
+    glm::vec4 get_uv_rect(int index) const { return m_uv_rects[index]; }
+
+    GLuint get_texture_id() const { return m_texture_id; }
+    int    get_width()      const { return m_width;  }
+    int    get_height()     const { return m_height; }
+
+private:
+    struct Placement { int x, y; };       // top-left corner of the sprite itself
+    struct Segment   { int x, y, width; }; // one flat piece of the skyline
+
+    bool pack(int width, int height, std::vector<Placement> &placements) const;
+    static bool find_position(const std::vector<Segment> &skyline, int atlas_width, int atlas_height,
+                              int width, int height, int &best_x, int &best_y, size_t &best_index);
+    static void place(std::vector<Segment> &skyline, size_t index, int x, int y, int width, int height);
+
+    std::vector<const Image *> m_images;
+    std::vector<glm::vec4>     m_uv_rects;
+    Image                      m_pixels;
+
+    GLuint m_texture_id = 0;
+    int    m_width      = 0;
+    int    m_height     = 0;
+};
@@ -0,0 +1,210 @@
+#include <iostream>
+#include <fstream>
+#include <cstddef>
+#include <cstring>
+#include <cstdio>
+#include <sys/stat.h>
+#include "TextureCache.h"
+#include "Hash.h"
+#include "Profiler.h"
+
+#ifdef _WINDOWS
+    #include <direct.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <unistd.h>
+#endif
+
+// sits at the start of every blob, the pixels follow right after it
+struct BlobHeader
+{
+    char     magic[4];
+    uint32_t version;
+    int32_t  width, height;                // of the cached pixels
+    int32_t  max_width, max_height;        // what they were fitted to
+    int32_t  source_width, source_height;  // what the PNG decoded to
+    uint64_t source_size;
+    int64_t  source_mtime;
+    uint64_t source_hash;
+};
+
+constexpr char BLOB_MAGIC[4] = { 'P', 'T', 'E', 'X' };
+
+static bool read_file(const char *filepath, std::vector<unsigned char> &bytes)
+{
+    std::ifstream file(filepath, std::ios::binary | std::ios::ate);
+    if (!file) return false;
+
+    bytes.resize((size_t) file.tellg());
+    file.seekg(0);
+    return (bool) file.read((char *) bytes.data(), bytes.size());
+}
+
+// maps the whole blob read-only; the pixels stay mapped for as long as any Image holds on to them
+static std::shared_ptr<const unsigned char> map_blob(const std::string &path, size_t &size)
+{
+#ifdef _WINDOWS
+    // no mmap here, reading it in is still a lot cheaper than decoding the PNG
+    auto bytes = std::make_shared<std::vector<unsigned char>>();
+    if (!read_file(path.c_str(), *bytes)) return nullptr;
+    size = bytes->size();
+    return std::shared_ptr<const unsigned char>(bytes, bytes->data());
+#else
+    int file = open(path.c_str(), O_RDONLY);
+    if (file < 0) return nullptr;
+
+    struct stat info;
+    if (fstat(file, &info) != 0 || info.st_size == 0)
+    {
+        close(file);
+        return nullptr;
+    }
+
+    size = (size_t) info.st_size;
+    void *mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0);
+    close(file);
+    if (mapping == MAP_FAILED) return nullptr;
+
+    return std::shared_ptr<const unsigned char>((const unsigned char *) mapping,
+                                                [size](const unsigned char *p) { munmap((void *) p, size); });
+#endif
+}
+
+// for a blob whose PNG was only touched: overwrites just the header's source_mtime, so the next
+// load passes the cheap check again. Done in place, a torn write only costs another hash
+static void update_source_mtime(const std::string &path, int64_t mtime)
+{
+    std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+    if (!file) return;
+
+    file.seekp(offsetof(BlobHeader, source_mtime));
+    file.write((const char *) &mtime, sizeof(mtime));
+}
+
+TextureCache::TextureCache(const char *directory) : m_directory(directory)
+{
+}
+
+std::string TextureCache::blob_path(const char *filepath) const
+{
+    std::string name = filepath;
+    for (char &c : name) if (c == '/' || c == '\\' || c == ':') c = '_';
+    return m_directory + "/" + name + ".rgba";
+}
+
+std::future<Image> TextureCache::load_async(const char *filepath, int max_width, int max_height)
+{
+    return std::async(std::launch::async, [this, filepath, max_width, max_height]()
+    {
+        Image image;
+        load(filepath, max_width, max_height, image);
+        return image;
+    });
+}
+
+bool TextureCache::load(const char *filepath, int max_width, int max_height, Image &image)
+{
+    PROFILE_ZONE("TextureCache::load");
+
+    struct stat source_info;
+    if (stat(filepath, &source_info) != 0)
+    {
+        std::cout << "Unable to load image " << filepath << ". Make sure the path is correct.\n";
+        image = Image();
+        return false;
+    }
+
+    std::string path = blob_path(filepath);
+    size_t blob_size = 0;
+    std::shared_ptr<const unsigned char> blob = map_blob(path, blob_size);
+
+    BlobHeader header;
+    bool is_usable = blob && blob_size >= sizeof(BlobHeader);
+    if (is_usable)
+    {
+        memcpy(&header, blob.get(), sizeof(header));
+        is_usable = memcmp(header.magic, BLOB_MAGIC, sizeof(BLOB_MAGIC)) == 0 &&
+                    header.version == FORMAT_VERSION &&
+                    header.max_width == max_width && header.max_height == max_height &&
+                    header.width > 0 && header.height > 0 &&
+                    blob_size == sizeof(BlobHeader) + (size_t) header.width * header.height * IMAGE_CHANNELS;
+    }
+
+    bool is_unchanged = is_usable && header.source_size == (uint64_t) source_info.st_size &&
+                        header.source_mtime == (int64_t) source_info.st_mtime;
+
+    // only pay for reading the PNG when the cheap checks fail, it may just have been touched
+    std::vector<unsigned char> source;
+    if (!is_unchanged)
+    {
+        if (!read_file(filepath, source))
+        {
+            std::cout << "Unable to load image " << filepath << ". Make sure the path is correct.\n";
+            image = Image();
+            return false;
+        }
+        is_unchanged = is_usable && header.source_size == source.size() && header.source_hash == hash_bytes(source.data(), source.size());
+        if (is_unchanged) update_source_mtime(path, (int64_t) source_info.st_mtime);
+    }
+
+    if (is_unchanged)
+    {
+        image = Image();
+        image.width  = header.width;
+        image.height = header.height;
+        image.mapped_pixels = std::shared_ptr<const unsigned char>(blob, blob.get() + sizeof(BlobHeader));
+
+        m_hits++;
+        m_bytes_saved += (size_t) header.source_width * header.source_height * IMAGE_CHANNELS - image.size();
+        return true;
+    }
+    blob.reset();
+
+    if (!decode_image(source.data(), source.size(), image))
+    {
+        std::cout << "Unable to decode image " << filepath << ".\n";
+        return false;
+    }
+
+    BlobHeader fresh;
+    memcpy(fresh.magic, BLOB_MAGIC, sizeof(BLOB_MAGIC));
+    fresh.version       = FORMAT_VERSION;
+    fresh.max_width     = max_width;
+    fresh.max_height    = max_height;
+    fresh.source_width  = image.width;
+    fresh.source_height = image.height;
+    fresh.source_size   = source.size();
+    fresh.source_mtime  = (int64_t) source_info.st_mtime;
+    fresh.source_hash   = hash_bytes(source.data(), source.size());
+
+    size_t saved = fit_image(image, max_width, max_height);
+    fresh.width  = image.width;
+    fresh.height = image.height;
+
+    m_misses++;
+    m_bytes_saved += saved;
+
+    // write to a temporary name and rename it over the old blob, so a crash never leaves half a file
+#ifdef _WINDOWS
+    _mkdir(m_directory.c_str());
+#else
+    mkdir(m_directory.c_str(), 0755);
+#endif
+    std::string temporary_path = path + ".tmp";
+    {
+        std::ofstream file(temporary_path, std::ios::binary | std::ios::trunc);
+        file.write((const char *) &fresh, sizeof(fresh));
+        file.write((const char *) image.data(), image.size());
+        if (!file)
+        {
+            // not being able to cache is fine, we still have the pixels
+            file.close();
+            std::remove(temporary_path.c_str());
+            return true;
+        }
+    }
+    std::remove(path.c_str());
+    std::rename(temporary_path.c_str(), path.c_str());
+    return true;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <future>
+#include <string>
+#include "Image.h"
+
+// keeps decoded (and already downscaled) sprites on disk as raw RGBA, so later launches can map
+// them straight in instead of inflating the PNGs again
+class TextureCache
+{
+public:
+    // bumped whenever the blob layout or the resampler changes, old blobs are then rebuilt
+    static constexpr uint32_t FORMAT_VERSION = 1;
+
+    TextureCache(const char *directory = "texture_cache");
+
+    // decodes `filepath` shrunk to fit max_width x max_height (see fit_image), from the cache when
+    // the blob there still matches the source file; false (and an empty image) if it can't be read
+    bool load(const char *filepath, int max_width, int max_height, Image &image);
+
+    // same as load(), but on its own thread straight away so several sprites decode at once; no GL
+    // is touched, the caller uploads once the future is ready. `filepath` has to outlive the future
+    std::future<Image> load_async(const char *filepath, int max_width, int max_height);
+
+    int    get_hits()        const { return m_hits; };
+    int    get_misses()      const { return m_misses; };
+    size_t get_bytes_saved() const { return m_bytes_saved; }; // by downscaling, compared to the full decode
+
+private:
+    std::string m_directory;
+
+    std::atomic<int>    m_hits{0};
+    std::atomic<int>    m_misses{0};
+    std::atomic<size_t> m_bytes_saved{0};
+
+    std::string blob_path(const char *filepath) const;
+};
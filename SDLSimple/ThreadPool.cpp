@@ -0,0 +1,166 @@
+#include "ThreadPool.h"
+#include "Profiler.h"
+
+WorkStealingPool::WorkStealingPool(size_t thread_count)
+{
+    if (thread_count == 0) thread_count = 1; // hardware_concurrency() is allowed to return 0
+
+    for (size_t i = 0; i < thread_count; i++) m_workers.push_back(std::make_unique<Worker>());
+    for (size_t i = 0; i < thread_count; i++)
+    {
+        m_workers[i]->thread = std::thread(&WorkStealingPool::worker_loop, this, i);
+    }
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_job_mutex);
+        m_stopping = true;
+    }
+    m_job_ready.notify_all();
+
+    for (auto &worker : m_workers) worker->thread.join();
+}
+
+void WorkStealingPool::parallel_for(size_t count, size_t chunk_size, const std::function<void(size_t, size_t)> &work)
+{
+    if (count == 0) return;
+    if (chunk_size == 0) chunk_size = 1;
+
+    std::lock_guard<std::mutex> submit_lock(m_submit_mutex);
+
+    size_t chunk_count  = (count + chunk_size - 1) / chunk_size,
+           worker_count = m_workers.size();
+
+    m_work = &work;
+    m_remaining.store(chunk_count);
+
+    // hand every worker one contiguous run of chunks so the common case never touches another queue
+    for (size_t w = 0; w < worker_count; w++)
+    {
+        size_t first = chunk_count * w / worker_count,
+               last  = chunk_count * (w + 1) / worker_count;
+
+        Worker &worker = *m_workers[w];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        if (worker.chunks.size() < last - first) worker.chunks.resize(last - first);
+
+        for (size_t c = first; c < last; c++)
+        {
+            size_t begin = c * chunk_size;
+            size_t end   = begin + chunk_size < count ? begin + chunk_size : count;
+            worker.chunks[c - first] = { begin, end };
+        }
+        worker.head = 0;
+        worker.tail = last - first;
+    }
+
+    std::unique_lock<std::mutex> lock(m_job_mutex);
+    m_generation++;
+    m_job_ready.notify_all();
+    m_job_done.wait(lock, [this] { return m_remaining.load() == 0; });
+
+    m_work = nullptr;
+}
+
+bool WorkStealingPool::pop_own(size_t index, Chunk &chunk)
+{
+    Worker &worker = *m_workers[index];
+    std::lock_guard<std::mutex> lock(worker.mutex);
+
+    if (worker.head == worker.tail) return false;
+    chunk = worker.chunks[worker.head++];
+    return true;
+}
+
+bool WorkStealingPool::steal(size_t thief, Chunk &chunk)
+{
+    size_t worker_count = m_workers.size();
+
+    // walk round the ring starting at our neighbour, taking from the back so the owner,
+    // which works from the front, keeps going through memory in order
+    for (size_t offset = 1; offset < worker_count; offset++)
+    {
+        Worker &victim = *m_workers[(thief + offset) % worker_count];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+
+        if (victim.head == victim.tail) continue;
+        chunk = victim.chunks[--victim.tail];
+        return true;
+    }
+    return false;
+}
+
+void WorkStealingPool::worker_loop(size_t index)
+{
+    Worker &self = *m_workers[index];
+    size_t seen_generation = 0;
+
+    Profiler::set_thread_name(("pool worker " + std::to_string(index)).c_str());
+
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_job_mutex);
+            m_job_ready.wait(lock, [&] { return m_stopping || m_generation != seen_generation; });
+            if (m_stopping) return;
+            seen_generation = m_generation;
+        }
+
+        // every chunk is queued before the job is announced, so once all queues
+        // are empty there is nothing left for this worker to pick up
+        Chunk chunk;
+        while (true)
+        {
+            if (!pop_own(index, chunk))
+            {
+                if (!steal(index, chunk)) break;
+                self.steals.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            (*m_work)(chunk.begin, chunk.end);
+            self.chunks_processed.fetch_add(1, std::memory_order_relaxed);
+
+            if (m_remaining.fetch_sub(1) == 1)
+            {
+                // take the lock so the caller can't miss the wake-up between its check and its wait
+                std::lock_guard<std::mutex> lock(m_job_mutex);
+                m_job_done.notify_all();
+            }
+        }
+    }
+}
+
+std::vector<WorkStealingPool::WorkerStats> WorkStealingPool::get_stats() const
+{
+    std::vector<WorkerStats> stats;
+    for (const auto &worker : m_workers)
+    {
+        stats.push_back({ worker->chunks_processed.load(), worker->steals.load() });
+    }
+    return stats;
+}
+
+void WorkStealingPool::reset_stats()
+{
+    for (auto &worker : m_workers)
+    {
+        worker->chunks_processed.store(0);
+        worker->steals.store(0);
+    }
+}
+
+void WorkStealingPool::print_stats(std::ostream &out) const
+{
+    std::vector<WorkerStats> stats = get_stats();
+    size_t total_chunks = 0, total_steals = 0;
+
+    for (size_t i = 0; i < stats.size(); i++)
+    {
+        out << "worker " << i << ": " << stats[i].chunks_processed << " chunks, " << stats[i].steals << " steals\n";
+        total_chunks += stats[i].chunks_processed;
+        total_steals += stats[i].steals;
+    }
+    out << "total: " << total_chunks << " chunks, " << total_steals << " steals over " << stats.size() << " workers\n";
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads that split a range of independent work items (e.g. the
+// matches in a MatchBatch) into chunks. Every worker starts with its own run of chunks
+// and, once that runs dry, steals from the far end of the first worker round the ring
+// (starting with its neighbour) that still has any.
+class WorkStealingPool
+{
+public:
+    struct WorkerStats
+    {
+        size_t chunks_processed;
+        size_t steals;
+    };
+
+    explicit WorkStealingPool(size_t thread_count = std::thread::hardware_concurrency());
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool &) = delete;
+    WorkStealingPool &operator=(const WorkStealingPool &) = delete;
+
+    // calls work(begin, end) for every chunk of [0, count) and returns once all of them are done.
+    // Only one parallel_for runs at a time; concurrent callers queue up.
+    void parallel_for(size_t count, size_t chunk_size, const std::function<void(size_t, size_t)> &work);
+
+    size_t get_thread_count() const { return m_workers.size(); }
+
+    std::vector<WorkerStats> get_stats() const;
+    void reset_stats();
+    void print_stats(std::ostream &out) const;
+
+private:
+    struct Chunk { size_t begin, end; };
+
+    // padded so one worker bumping its counters doesn't invalidate its neighbour's cache line
+    // chunks[head, tail) are still to do: the owner takes from the head, thieves from the tail.
+    // parallel_for refills it from the start each time, so after the first few jobs it has room
+    // and handing out work never allocates
+    struct alignas(64) Worker
+    {
+        std::mutex          mutex;
+        std::vector<Chunk>  chunks;
+        size_t              head = 0, tail = 0;
+        std::atomic<size_t> chunks_processed { 0 };
+        std::atomic<size_t> steals { 0 };
+        std::thread         thread;
+    };
+
+    void worker_loop(size_t index);
+    bool pop_own(size_t index, Chunk &chunk);
+    bool steal(size_t thief, Chunk &chunk);
+
+    std::vector<std::unique_ptr<Worker>> m_workers;
+
+    std::mutex m_submit_mutex; // serialises parallel_for callers
+
+    std::mutex              m_job_mutex;
+    std::condition_variable m_job_ready;
+    std::condition_variable m_job_done;
+    size_t                  m_generation = 0;
+    bool                    m_stopping   = false;
+
+    const std::function<void(size_t, size_t)> *m_work = nullptr;
+    std::atomic<size_t> m_remaining { 0 };
+};
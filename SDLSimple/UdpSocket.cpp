@@ -0,0 +1,127 @@
+#include <iostream>
+#include <cerrno>
+#include <cstring>
+#include "UdpSocket.h"
+
+#ifndef _WINDOWS
+    #include <arpa/inet.h>
+    #include <fcntl.h>
+    #include <netinet/in.h>
+    #include <sys/socket.h>
+    #include <unistd.h>
+
+    static_assert(sizeof(sockaddr_in) <= 16, "m_peer_address is too small");
+#endif
+
+bool UdpSocket::open(uint16_t local_port, const char *peer_host, uint16_t peer_port)
+{
+    close();
+#ifdef _WINDOWS
+    (void) local_port; (void) peer_host; (void) peer_port;
+    std::cout << "Networking isn't available in Windows builds yet.\n";
+    return false;
+#else
+    m_socket = socket(AF_INET, SOCK_DGRAM, 0);
+    if (m_socket < 0)
+    {
+        std::cout << "Unable to create a UDP socket: " << strerror(errno) << "\n";
+        return false;
+    }
+
+    sockaddr_in local = {};
+    local.sin_family      = AF_INET;
+    local.sin_port        = htons(local_port);
+    local.sin_addr.s_addr = htonl(INADDR_ANY);
+
+    sockaddr_in peer = {};
+    peer.sin_family = AF_INET;
+    peer.sin_port   = htons(peer_port);
+
+    if (bind(m_socket, (const sockaddr *) &local, sizeof(local)) != 0 ||
+        inet_pton(AF_INET, peer_host, &peer.sin_addr) != 1 ||
+        fcntl(m_socket, F_SETFL, fcntl(m_socket, F_GETFL) | O_NONBLOCK) != 0)
+    {
+        std::cout << "Unable to set up UDP port " << local_port << " talking to " << peer_host << ":" << peer_port
+                  << ": " << strerror(errno) << "\n";
+        close();
+        return false;
+    }
+
+    memcpy(m_peer_address, &peer, sizeof(peer));
+    return true;
+#endif
+}
+
+void UdpSocket::close()
+{
+#ifndef _WINDOWS
+    if (m_socket >= 0) ::close(m_socket);
+#endif
+    m_socket = -1;
+    m_delayed.clear();
+}
+
+void UdpSocket::set_conditions(const LinkConditions &conditions)
+{
+    m_conditions = conditions;
+    m_random.seed(conditions.seed);
+}
+
+void UdpSocket::send_now(const void *data, size_t size)
+{
+#ifndef _WINDOWS
+    // a full send buffer is as good as a lost packet for UDP, the next one carries the same inputs
+    sendto(m_socket, data, size, 0, (const sockaddr *) m_peer_address, sizeof(sockaddr_in));
+#else
+    (void) data; (void) size;
+#endif
+}
+
+void UdpSocket::send(const void *data, size_t size, double now)
+{
+    if (m_socket < 0) return;
+    m_packets_sent++;
+
+    if (m_conditions.loss > 0.0f && std::uniform_real_distribution<float>(0.0f, 1.0f)(m_random) < m_conditions.loss)
+    {
+        m_packets_dropped++;
+        return;
+    }
+
+    if (m_conditions.latency <= 0.0 && m_conditions.jitter <= 0.0)
+    {
+        send_now(data, size);
+        return;
+    }
+
+    double delay = m_conditions.latency + std::uniform_real_distribution<double>(0.0, m_conditions.jitter)(m_random);
+    const unsigned char *bytes = (const unsigned char *) data;
+    m_delayed.push_back({ now + delay, std::vector<unsigned char>(bytes, bytes + size) });
+}
+
+void UdpSocket::flush(double now)
+{
+    // jitter means the queue isn't sorted by due time, which is the point: packets get reordered
+    for (auto it = m_delayed.begin(); it != m_delayed.end(); )
+    {
+        if (it->due <= now) {
+            send_now(it->bytes.data(), it->bytes.size());
+            it = m_delayed.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+size_t UdpSocket::receive(void *buffer, size_t capacity)
+{
+#ifndef _WINDOWS
+    if (m_socket < 0) return 0;
+
+    ssize_t received = recv(m_socket, buffer, capacity, 0);
+    return received > 0 ? (size_t) received : 0;
+#else
+    (void) buffer; (void) capacity;
+    return 0;
+#endif
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <random>
+#include <vector>
+
+// bad-network settings for testing on localhost; outgoing packets are held back or dropped
+struct LinkConditions
+{
+    double   latency    = 0.0;  // seconds each packet is held before it's really sent
+    double   jitter     = 0.0;  // plus up to this much more, so packets can also arrive out of order
+    float    loss       = 0.0f; // 0..1, fraction of packets dropped
+    uint32_t seed       = 1;    // same seed, same drops and delays
+};
+
+// Non-blocking UDP socket talking to a single peer. Sends go through an optional delay/loss
+// queue (see LinkConditions) which flush() drains, so the caller decides what "now" is and a
+// test can run on a simulated clock. POSIX sockets only; open() fails on Windows builds.
+class UdpSocket
+{
+public:
+    static constexpr size_t MAX_PACKET_SIZE = 1200; // comfortably under any MTU
+
+    UdpSocket() = default;
+    ~UdpSocket() { close(); }
+
+    UdpSocket(const UdpSocket &) = delete;
+    UdpSocket &operator=(const UdpSocket &) = delete;
+
+    // binds to local_port (0 for any) and sends to host:peer_port from then on; false (with a
+    // message) if the socket couldn't be set up
+    bool open(uint16_t local_port, const char *peer_host, uint16_t peer_port);
+    void close();
+
+    void set_conditions(const LinkConditions &conditions);
+
+    void send(const void *data, size_t size, double now);
+    void flush(double now);
+
+    // size of the packet copied into `buffer`, 0 once there's nothing left to read
+    size_t receive(void *buffer, size_t capacity);
+
+    size_t get_packets_sent()    const { return m_packets_sent; }
+    size_t get_packets_dropped() const { return m_packets_dropped; }
+
+private:
+    struct Delayed
+    {
+        double due;
+        std::vector<unsigned char> bytes;
+    };
+
+    void send_now(const void *data, size_t size);
+
+    int           m_socket = -1;
+    unsigned char m_peer_address[16] = {}; // a sockaddr_in, kept opaque so this header stays free of socket headers
+
+    LinkConditions      m_conditions;
+    std::mt19937        m_random;
+    std::deque<Delayed> m_delayed;
+
+    size_t m_packets_sent    = 0;
+    size_t m_packets_dropped = 0;
+};
@@ -0,0 +1,101 @@
+#include "VecEnv.h"
+
+// serves start this far above or below the middle at most, well clear of the walls
+constexpr float MAX_SERVE_Y = 2.0f;
+
+// splitmix64: tiny state, and good enough output even from consecutive seeds
+static uint64_t next_random(uint64_t &state)
+{
+    uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+VecEnv::VecEnv(size_t env_count, const VecEnvSettings &settings)
+    : m_settings(settings), m_batch(env_count), m_inputs(env_count), m_episode_ticks(env_count, 0), m_random(env_count)
+{
+    m_initial_state.is_single_player_mode = settings.is_cat2_ai;
+    for (size_t i = 0; i < env_count; i++) m_random[i] = (uint64_t) settings.seed << 32 | i;
+
+    if (settings.thread_count > 1) m_pool = std::make_unique<WorkStealingPool>(settings.thread_count);
+    m_step_range = [this](size_t begin, size_t end) { step_range(begin, end); };
+}
+
+void VecEnv::observe(size_t index, float *observation) const
+{
+    float speed = m_batch.ball_speed[index];
+    observation[BALL_X]          = m_batch.ball_x[index];
+    observation[BALL_Y]          = m_batch.ball_y[index];
+    observation[BALL_VELOCITY_X] = m_batch.velocity_x[index] * speed;
+    observation[BALL_VELOCITY_Y] = m_batch.velocity_y[index] * speed;
+    observation[CAT1_Y]          = m_batch.cat1_y[index] + INIT_POS_CAT1.y;
+    observation[CAT2_Y]          = m_batch.cat2_y[index] + INIT_POS_CAT2.y;
+}
+
+void VecEnv::start_episode(size_t index)
+{
+    uint64_t bits = next_random(m_random[index]);
+
+    PongSim serve = m_initial_state;
+    serve.ball_position.y = ((float) (bits >> 40) / (float) (1 << 24) * 2.0f - 1.0f) * MAX_SERVE_Y;
+    serve.ball_velocity.x = bits & 1 ? INIT_VEL_BALL.x : -INIT_VEL_BALL.x;
+    serve.ball_velocity.y = bits & 2 ? INIT_VEL_BALL.y : -INIT_VEL_BALL.y;
+
+    m_batch.load(index, serve);
+    m_episode_ticks[index] = 0;
+}
+
+void VecEnv::reset(float *observations)
+{
+    for (size_t i = 0; i < size(); i++)
+    {
+        start_episode(i);
+        observe(i, observations + i * OBSERVATION_SIZE);
+    }
+}
+
+void VecEnv::step(const int8_t *actions, float *observations, float *rewards, uint8_t *dones)
+{
+    m_actions      = actions;
+    m_observations = observations;
+    m_rewards      = rewards;
+    m_dones        = dones;
+
+    if (m_pool) {
+        m_pool->parallel_for(size(), m_settings.chunk_size, m_step_range);
+    } else {
+        step_range(0, size());
+    }
+}
+
+void VecEnv::step_range(size_t begin, size_t end)
+{
+    for (size_t i = begin; i < end; i++)
+    {
+        const int8_t *action = m_actions + i * ACTIONS_PER_ENV;
+        PongInputs &inputs = m_inputs[i];
+        inputs.cat1_up   = action[0] > 0;
+        inputs.cat1_down = action[0] < 0;
+        inputs.cat2_up   = action[1] > 0;
+        inputs.cat2_down = action[1] < 0;
+    }
+
+    m_batch.step_range(begin, end, m_inputs.data(), FIXED_TIMESTEP, m_settings.ai);
+
+    for (size_t i = begin; i < end; i++)
+    {
+        float   reward = 0.0f;
+        uint8_t done   = m_batch.is_game_over[i];
+
+        // the ball leaving on the right is cat2's miss
+        if (done) reward = m_batch.ball_x[i] > 0.0f ? 1.0f : -1.0f;
+        if (++m_episode_ticks[i] == m_settings.max_episode_ticks) done = 1;
+
+        if (done) start_episode(i);
+
+        m_rewards[i] = reward;
+        m_dones[i]   = done;
+        observe(i, m_observations + i * OBSERVATION_SIZE);
+    }
+}
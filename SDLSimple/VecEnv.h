@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+#include "MatchBatch.h"
+#include "ThreadPool.h"
+
+struct VecEnvSettings
+{
+    bool       is_cat2_ai        = true; // cat2 is PaddleAI and its actions are ignored, otherwise both paddles are agents
+    AiSettings ai                = AiSettings();
+    uint32_t   max_episode_ticks = 0;    // episodes running this long are cut off (reported as done, no reward), 0 for never
+    size_t     thread_count      = 1;    // more than one spreads step() over a WorkStealingPool
+    size_t     chunk_size        = 4096; // envs per work item when threaded
+    uint32_t   seed              = 1;    // picks every episode's serve, same seed same serves
+};
+
+// N independent matches behind a reset()/step() interface for training paddle agents. It steps a
+// MatchBatch, so the rules and constants are the game's own (PongRules.h, step()), only sped up.
+// Every buffer is the caller's and laid out env by env; nothing is allocated after construction.
+//
+// Observations are OBSERVATION_SIZE floats per env, in court units: ball centre, ball velocity
+// (already multiplied by its speed) and both paddle centres. Actions are ACTIONS_PER_ENV values
+// per env, cat1's then cat2's, each 1 (up), -1 (down) or 0. Rewards are from cat1's side: +1
+// when cat2 misses, -1 when cat1 does. Envs that finish are reset straight away, their flag in
+// `dones` is set and their observation is already the new episode's first.
+//
+// Each episode serves from the middle of the court at a random height, along a random one of
+// the four diagonals, so envs given the same actions still play different rallies. The serves
+// come from a small generator per env, seeded from `seed` and the env's index, so they're the
+// same however many threads step them.
+class VecEnv
+{
+public:
+    enum Observation { BALL_X, BALL_Y, BALL_VELOCITY_X, BALL_VELOCITY_Y, CAT1_Y, CAT2_Y, OBSERVATION_SIZE };
+
+    static constexpr size_t ACTIONS_PER_ENV = 2;
+
+    explicit VecEnv(size_t env_count, const VecEnvSettings &settings = VecEnvSettings());
+
+    size_t size() const { return m_batch.size(); }
+
+    // starts every env over; `observations` holds size() * OBSERVATION_SIZE floats
+    void reset(float *observations);
+
+    // advances every env by one FIXED_TIMESTEP
+    void step(const int8_t *actions, float *observations, float *rewards, uint8_t *dones);
+
+private:
+    void step_range(size_t begin, size_t end);
+    void start_episode(size_t index);
+    void observe(size_t index, float *observation) const;
+
+    VecEnvSettings m_settings;
+    PongSim        m_initial_state;
+
+    MatchBatch              m_batch;
+    std::vector<PongInputs> m_inputs;
+    std::vector<uint32_t>   m_episode_ticks;
+    std::vector<uint64_t>   m_random; // splitmix64 state per env
+
+    std::unique_ptr<WorkStealingPool>  m_pool;
+    std::function<void(size_t, size_t)> m_step_range; // built once, so handing it to the pool doesn't allocate
+
+    // the current step()'s buffers, for the workers
+    const int8_t *m_actions      = nullptr;
+    float        *m_observations = nullptr;
+    float        *m_rewards      = nullptr;
+    uint8_t      *m_dones        = nullptr;
+};
@@ -0,0 +1,56 @@
+/* Scalar vs SIMD collision kernel over a MatchBatch.
+
+   Build from SDLSimple/ (Google Benchmark installed):
+     c++ -std=c++17 -O2 -march=native -ffp-contract=off -I. bench/collision_bench.cpp \
+         CollisionKernel.cpp SweptCollision.cpp MatchBatch.cpp PongSim.cpp PaddleAI.cpp -lbenchmark -lbenchmark_main -pthread
+*/
+#include <benchmark/benchmark.h>
+#include <random>
+#include "MatchBatch.h"
+#include "CollisionKernel.h"
+
+// spread the balls over the whole court so every branch of the kernel gets exercised
+static MatchBatch make_batch(size_t match_count)
+{
+    MatchBatch batch(match_count);
+    std::mt19937 rng(3113);
+    std::uniform_real_distribution<float> x(-4.4f, 4.4f), y(-3.2f, 3.2f), v(-2.0f, 2.0f), paddle(-2.5f, 2.5f);
+
+    for (size_t i = 0; i < match_count; i++)
+    {
+        batch.ball_x[i]     = x(rng);
+        batch.ball_y[i]     = y(rng);
+        batch.velocity_x[i] = v(rng);
+        batch.velocity_y[i] = v(rng);
+        batch.cat1_y[i]     = paddle(rng);
+        batch.cat2_y[i]     = paddle(rng);
+    }
+    return batch;
+}
+
+static CollisionLanes lanes_of(MatchBatch &batch)
+{
+    return { batch.ball_x.data(), batch.ball_y.data(), batch.velocity_x.data(), batch.velocity_y.data(),
+             batch.ball_speed.data(), batch.cat1_y.data(), batch.cat2_y.data(), batch.is_game_over.data() };
+}
+
+template <void (*Kernel)(const CollisionLanes &, size_t, size_t, float)>
+static void BM_Collision(benchmark::State &state)
+{
+    MatchBatch batch = make_batch((size_t) state.range(0));
+    CollisionLanes lanes = lanes_of(batch);
+
+    for (auto _ : state)
+    {
+        // keep every match alive so each iteration does the same amount of work
+        std::fill(batch.is_game_over.begin(), batch.is_game_over.end(), 0);
+        Kernel(lanes, 0, batch.size(), FIXED_TIMESTEP);
+        benchmark::DoNotOptimize(batch.ball_x.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    state.SetLabel(Kernel == resolve_collisions ? collision_kernel_name() : "scalar");
+}
+
+BENCHMARK_TEMPLATE(BM_Collision, resolve_collisions_scalar)->RangeMultiplier(8)->Range(1 << 10, 1 << 17);
+BENCHMARK_TEMPLATE(BM_Collision, resolve_collisions)->RangeMultiplier(8)->Range(1 << 10, 1 << 17);
@@ -0,0 +1,330 @@
+/* Microbenchmarks for the per-frame work: a fixed simulation step, VecEnv, a netplay rollback,
+   snapshot delta encode/decode, the translate + scale model matrix every sprite used to need,
+   decoding each bundled PNG, and submitting a frame through SpriteBatch on a headless (EGL)
+   context. Results go to pong_bench.json unless --benchmark_out says otherwise, so runs can be
+   diffed between commits (e.g. with benchmark's compare.py).
+
+   Run from SDLSimple/ so the shaders and PNGs are found. The CMake build has it as the pong_bench
+   target; by hand, from SDLSimple/ (Google Benchmark, EGL and GL installed), together with
+   bench/collision_bench.cpp for the collision kernels:
+     c++ -std=c++20 -O2 -march=native -ffp-contract=off -I. bench/pong_bench.cpp bench/collision_bench.cpp \
+         PongSim.cpp SweptCollision.cpp PaddleAI.cpp CollisionKernel.cpp MatchBatch.cpp VecEnv.cpp ThreadPool.cpp \
+         Rollback.cpp Snapshot.cpp ShaderProgram.cpp SpriteBatch.cpp TextureAtlas.cpp Image.cpp GLSupport.cpp \
+         OffscreenContext.cpp Profiler.cpp stb_image.cpp \
+         -lbenchmark -lGL -lEGL -pthread
+*/
+#include <benchmark/benchmark.h>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "glm/mat4x4.hpp"
+#include "glm/gtc/matrix_transform.hpp"
+#include "PongSim.h"
+#include "VecEnv.h"
+#include "Rollback.h"
+#include "Snapshot.h"
+#include "Image.h"
+#include "stb_image.h"
+#include "ShaderProgram.h"
+#include "SpriteBatch.h"
+#include "TextureAtlas.h"
+#include "OffscreenContext.h"
+
+constexpr int BENCH_WIDTH  = 1200,
+              BENCH_HEIGHT = 720;
+
+// one fixed step of the real game rules, with both players holding a direction so the paddle
+// code runs too; a finished match restarts so every iteration does comparable work
+static void BM_SimStep(benchmark::State &state)
+{
+    PongSim sim = PongSim();
+    PongInputs inputs = PongInputs();
+    inputs.cat1_up   = true;
+    inputs.cat2_down = true;
+
+    for (auto _ : state)
+    {
+        step(sim, inputs, FIXED_TIMESTEP);
+        if (sim.is_game_over) sim = PongSim();
+        benchmark::DoNotOptimize(sim);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SimStep);
+
+// env-steps per second for the training API, agents holding patterns of up/down/nothing against
+// the AI; the argument is the env count, the second one the threads
+static void BM_VecEnvStep(benchmark::State &state)
+{
+    VecEnvSettings settings;
+    settings.thread_count = (size_t) state.range(1);
+
+    VecEnv env((size_t) state.range(0), settings);
+    std::vector<int8_t>  actions(env.size() * VecEnv::ACTIONS_PER_ENV);
+    std::vector<float>   observations(env.size() * VecEnv::OBSERVATION_SIZE), rewards(env.size());
+    std::vector<uint8_t> dones(env.size());
+    for (size_t i = 0; i < actions.size(); i++) actions[i] = (int8_t) (i % 3) - 1;
+
+    env.reset(observations.data());
+    for (auto _ : state)
+    {
+        env.step(actions.data(), observations.data(), rewards.data(), dones.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * (int64_t) env.size());
+}
+BENCHMARK(BM_VecEnvStep)->Args({ 4096, 1 })->Args({ 131072, 1 })
+                        ->Args({ 131072, (int64_t) std::thread::hardware_concurrency() })->UseRealTime();
+
+// a rollback as a peer's late packet causes one: 10 ticks predicted, then their real inputs turn
+// out different from the first of them, so synchronise() restores and simulates all 10 again.
+// Per iteration that's 20 steps; compare with 20x BM_SimStep for the snapshot overhead.
+static void BM_Rollback(benchmark::State &state)
+{
+    constexpr int DEPTH = 10;
+
+    RollbackSession session;
+    session.start(0);
+
+    unsigned char packet[RollbackSession::MAX_PACKET_SIZE] = { 'P', 'R', 1, DEPTH };
+    uint8_t remote = PADDLE_UP;
+
+    for (auto _ : state)
+    {
+        long long first = session.get_tick();
+        for (int i = 0; i < DEPTH; i++) session.advance(PADDLE_DOWN);
+
+        // the prediction repeats the last input, so flipping it forces the full depth
+        remote = remote == PADDLE_UP ? PADDLE_DOWN : PADDLE_UP;
+        for (int b = 0; b < 4; b++)
+        {
+            packet[4 + b] = (unsigned char) (first >> (8 * b));
+            packet[8 + b] = (unsigned char) (session.get_tick() >> (8 * b));
+        }
+        memset(packet + 12, remote, DEPTH);
+
+        // the packet is laid out by hand, so make sure it's still one read_packet() takes and
+        // that it really caused a rollback, rather than quietly timing plain steps
+        size_t rollbacks = session.get_stats().rollbacks;
+        if (!session.read_packet(packet, 12 + DEPTH))
+        {
+            state.SkipWithError("read_packet() turned the packet down, the layout here is out of date");
+            return;
+        }
+        session.synchronise();
+        if (session.get_stats().rollbacks != rollbacks + 1)
+        {
+            state.SkipWithError("the packet didn't cause a rollback");
+            return;
+        }
+        if (session.get_state().is_game_over) session.start(0);
+        benchmark::DoNotOptimize(session.get_state());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Rollback);
+
+// consecutive ticks of a single-player match with cat1 moving, so the ball, both paddles and
+// the AI's plan all change along the way, quantized once each as a broadcast would
+static std::vector<QuantizedSim> snapshot_ticks()
+{
+    std::vector<QuantizedSim> ticks(1024);
+    PongSim sim = PongSim();
+    sim.is_single_player_mode = true;
+
+    for (size_t i = 0; i < ticks.size(); i++)
+    {
+        PongInputs inputs = PongInputs();
+        inputs.cat1_up   = (i / 120) % 2 == 0;
+        inputs.cat1_down = !inputs.cat1_up;
+
+        step(sim, inputs, FIXED_TIMESTEP);
+        if (sim.is_game_over) { sim = PongSim(); sim.is_single_player_mode = true; }
+        ticks[i] = quantize_sim(sim);
+    }
+    return ticks;
+}
+
+// each tick as a delta against the one before; bytes_per_snapshot is the average delta size
+static void BM_SnapshotEncode(benchmark::State &state)
+{
+    std::vector<QuantizedSim> ticks = snapshot_ticks();
+    unsigned char buffer[SNAPSHOT_MAX_SIZE];
+    size_t i = 0, bytes = 0;
+
+    for (auto _ : state)
+    {
+        size_t next = (i + 1) & (ticks.size() - 1);
+        bytes += encode_snapshot(ticks[next], &ticks[i], buffer);
+        benchmark::DoNotOptimize(buffer);
+        i = next;
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.counters["bytes_per_snapshot"] = (double) bytes / (double) state.iterations();
+}
+BENCHMARK(BM_SnapshotEncode);
+
+static void BM_SnapshotDecode(benchmark::State &state)
+{
+    std::vector<QuantizedSim> ticks = snapshot_ticks();
+    std::vector<unsigned char> deltas(ticks.size() * SNAPSHOT_MAX_SIZE);
+    std::vector<size_t> sizes(ticks.size());
+    for (size_t i = 0; i < ticks.size(); i++)
+    {
+        sizes[i] = encode_snapshot(ticks[(i + 1) & (ticks.size() - 1)], &ticks[i], &deltas[i * SNAPSHOT_MAX_SIZE]);
+    }
+
+    QuantizedSim decoded;
+    size_t i = 0;
+    for (auto _ : state)
+    {
+        decode_snapshot(&deltas[i * SNAPSHOT_MAX_SIZE], sizes[i], &ticks[i], decoded);
+        benchmark::DoNotOptimize(decoded);
+        i = (i + 1) & (ticks.size() - 1);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SnapshotDecode);
+
+// what render() did per object before SpriteBatch: identity, translate, scale
+static void BM_MatrixBuild(benchmark::State &state)
+{
+    const glm::vec3 positions[4] = { glm::vec3(0.0f, 0.5f, 0.0f), INIT_POS_CAT1, INIT_POS_CAT2, INIT_POS_BALL },
+                    scales[4]    = { glm::vec3(10.5f, 8.98f, 0.0f), glm::vec3(2.0f, 1.98f, 0.0f),
+                                     glm::vec3(2.0f, 1.98f, 0.0f), glm::vec3(-1.0f, 1.0f, 0.0f) };
+    glm::mat4 matrices[4];
+
+    for (auto _ : state)
+    {
+        for (int i = 0; i < 4; i++)
+        {
+            benchmark::DoNotOptimize(positions[i]);
+            matrices[i] = glm::scale(glm::translate(glm::mat4(1.0f), positions[i]), scales[i]);
+        }
+        benchmark::DoNotOptimize(matrices);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * 4);
+}
+BENCHMARK(BM_MatrixBuild);
+
+static void BM_StbiLoad(benchmark::State &state, const char *filepath)
+{
+    size_t bytes = 0;
+    for (auto _ : state)
+    {
+        int width, height, number_of_components;
+        unsigned char *pixels = stbi_load(filepath, &width, &height, &number_of_components, STBI_rgb_alpha);
+        if (pixels == NULL)
+        {
+            state.SkipWithError("couldn't load the image, run from SDLSimple/");
+            return;
+        }
+        bytes = (size_t) width * height * IMAGE_CHANNELS;
+        benchmark::DoNotOptimize(pixels);
+        stbi_image_free(pixels);
+    }
+    state.SetBytesProcessed(state.iterations() * bytes); // decoded bytes
+}
+BENCHMARK_CAPTURE(BM_StbiLoad, SV_BG, "SV_BG.png")->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_StbiLoad, cat1, "cat1.png")->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_StbiLoad, cat2, "cat2.png")->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_StbiLoad, strawb, "strawb.png")->Unit(benchmark::kMillisecond);
+
+// the game's scene (background, two cats, ball out of one atlas) through SpriteBatch, waiting for
+// the frame with glFinish since there's no swap to do it for us
+static void BM_RenderSubmission(benchmark::State &state)
+{
+    OffscreenContext context;
+    if (!context.create(BENCH_WIDTH, BENCH_HEIGHT))
+    {
+        state.SkipWithError("no offscreen GL context");
+        return;
+    }
+    glViewport(0, 0, BENCH_WIDTH, BENCH_HEIGHT);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    ShaderProgram program;
+    program.load("shaders/vertex_instanced.glsl", "shaders/fragment_textured.glsl");
+    program.set_projection_matrix(glm::ortho(-5.0f, 5.0f, -3.75f, 3.75f, -1.0f, 1.0f));
+    program.set_view_matrix(glm::mat4(1.0f));
+
+    const char *filepaths[4] = { "SV_BG.png", "cat1.png", "cat2.png", "strawb.png" };
+    Image images[4];
+    TextureAtlas atlas;
+    for (int i = 0; i < 4; i++)
+    {
+        if (!load_image(filepaths[i], images[i]))
+        {
+            state.SkipWithError("couldn't load the sprites, run from SDLSimple/");
+            return;
+        }
+        atlas.add(images[i]);
+    }
+    GLint max_texture_size = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_texture_size);
+    atlas.build(max_texture_size);
+    GLuint texture_id = atlas.upload();
+
+    SpriteBatch batch;
+    batch.initialise(program);
+
+    const glm::vec3 positions[4] = { glm::vec3(0.0f, 0.5f, 0.0f), INIT_POS_CAT1, INIT_POS_CAT2, INIT_POS_BALL },
+                    scales[4]    = { glm::vec3(10.5f, 8.98f, 0.0f), glm::vec3(2.0f, 1.98f, 0.0f),
+                                     glm::vec3(2.0f, 1.98f, 0.0f), glm::vec3(-1.0f, 1.0f, 0.0f) };
+
+    // one untimed frame so the driver's lazy setup (shader variants, texture residency) isn't counted
+    batch.begin();
+    for (int i = 0; i < 4; i++) batch.draw(texture_id, positions[i], scales[i], atlas.get_uv_rect(i));
+    batch.flush();
+    glFinish();
+
+    // every run gets a fresh context, so make sure this one really has the program bound
+    GLint current_program = 0;
+    glGetIntegerv(GL_CURRENT_PROGRAM, &current_program);
+    if ((GLuint) current_program != program.get_program_id() || glGetError() != GL_NO_ERROR)
+    {
+        state.SkipWithError("the shader program isn't bound");
+        return;
+    }
+
+    for (auto _ : state)
+    {
+        glClear(GL_COLOR_BUFFER_BIT);
+        batch.begin();
+        for (int i = 0; i < 4; i++) batch.draw(texture_id, positions[i], scales[i], atlas.get_uv_rect(i));
+        batch.flush();
+        glFinish();
+    }
+    state.SetItemsProcessed(state.iterations()); // frames
+    state.SetLabel((const char *) glGetString(GL_RENDERER));
+
+    batch.cleanup();
+    atlas.cleanup();
+    program.cleanup();
+}
+BENCHMARK(BM_RenderSubmission)->Unit(benchmark::kMillisecond);
+
+// BENCHMARK_MAIN, but writing JSON to pong_bench.json by default
+int main(int argc, char **argv)
+{
+    std::vector<char *> arguments(argv, argv + argc);
+    std::string out_argument = "--benchmark_out=pong_bench.json",
+                format_argument = "--benchmark_out_format=json";
+
+    bool has_out = false;
+    for (int i = 1; i < argc; i++) has_out |= strncmp(argv[i], "--benchmark_out=", 16) == 0;
+    if (!has_out)
+    {
+        arguments.push_back(out_argument.data());
+        arguments.push_back(format_argument.data());
+    }
+
+    int argument_count = (int) arguments.size();
+    benchmark::Initialize(&argument_count, arguments.data());
+    if (benchmark::ReportUnrecognizedArguments(argument_count, arguments.data())) return 1;
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
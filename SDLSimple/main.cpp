@@ -8,7 +8,6 @@
 * Academic Misconduct.
 **/
 #define GL_SILENCE_DEPRECATION
-#define STB_IMAGE_IMPLEMENTATION
 #define LOG(argument) std::cout << argument << '\n'
 #define GL_GLEXT_PROTOTYPES 1
 
@@ -18,9 +17,32 @@
 
 #include <SDL.h>
 #include <SDL_opengl.h>
+#include <chrono>
+#include <cmath>
+#include <future>
+#include <cstring>
+#include <filesystem>
 #include "glm/mat4x4.hpp"
 #include "glm/gtc/matrix_transform.hpp"
 #include "ShaderProgram.h"
+#include "GLSupport.h"
+#include "CameraBuffer.h"
+#include "SpriteBatch.h"
+#include "TextureAtlas.h"
+#include "TextureCache.h"
+#include "Image.h"
+#include "PongSim.h"
+#include "MatchBatch.h"
+#include "ThreadPool.h"
+#include "Profiler.h"
+#include "FrameStats.h"
+#include "StatsHud.h"
+#include "OffscreenContext.h"
+#include "InputRecording.h"
+#include "Rollback.h"
+#include "UdpSocket.h"
+#include "Broadcast.h"
+#include "SweptCollision.h"
 #include "stb_image.h"
 
 enum AppStatus { RUNNING, TERMINATED };
@@ -38,8 +60,11 @@ constexpr int VIEWPORT_X      = 0,
               VIEWPORT_WIDTH  = WINDOW_WIDTH,
               VIEWPORT_HEIGHT = WINDOW_HEIGHT;
 
-constexpr char V_SHADER_PATH[] = "shaders/vertex_textured.glsl",
-               F_SHADER_PATH[] = "shaders/fragment_textured.glsl";
+// GLSL 1.10 runs anywhere but core profiles, the 3.30 pair is used from GL 3.3 on
+constexpr char V_SHADER_PATH[]     = "shaders/vertex_instanced.glsl",
+               F_SHADER_PATH[]     = "shaders/fragment_textured.glsl",
+               V_SHADER_330_PATH[] = "shaders/vertex_instanced_330.glsl",
+               F_SHADER_330_PATH[] = "shaders/fragment_textured_330.glsl";
 
 constexpr float MILLISECONDS_IN_SECOND = 1000.0;
 
@@ -56,58 +81,108 @@ constexpr char BG_SPRITE_FILEPATH[]    = "SV_BG.png",
 constexpr glm::vec3 INIT_SCALE       = glm::vec3(2.0f, 1.98f, 0.0f),
                     BG_SCALE       = glm::vec3(10.5f, 8.98f, 0.0f),
                     BALL_SCALE       = glm::vec3(-1.0f, 1.0f, 0.0f),
-                    INIT_POS_BG    = glm::vec3(0.0f, .5f, 0.0f),
-                    INIT_POS_CAT1    = glm::vec3(-4.0f, 0.0f, 0.0f),
-                    INIT_POS_CAT2    = glm::vec3(4.0f, 0.0f, 0.0f),
-                    INIT_POS_BALL    = glm::vec3(0.0f, 0.0f, 0.0f);
+                    INIT_POS_BG    = glm::vec3(0.0f, .5f, 0.0f);
 
 constexpr float ROT_INCREMENT = 1.0f;
 
-// global variables needed
-glm::vec3 g_cat1_position = glm::vec3(0.0f, 0.0f, 0.0f);
-glm::vec3 g_cat2_position = glm::vec3(0.0f, 0.0f, 0.0f);
-
-// global variables for the ball
-glm::vec3 g_ball_position = INIT_POS_BALL;
-glm::vec3 g_ball_velocity = glm::vec3(1.0f, 1.0f, 0.0f); // spawn & start with a diagonal movement
-float g_ball_speed = 1.0f;
-
-// requirement 2: global variables for single-player switch
-bool is_single_player_mode = false;
-float g_cat2_auto_direction = 1.0f; // 1: moving up, -1: moving down
+// the projection maps the court onto the whole window, so this is how many pixels one world unit covers
+constexpr float PIXELS_PER_UNIT_X = WINDOW_WIDTH / (COURT_RIGHT - COURT_LEFT),
+                PIXELS_PER_UNIT_Y = WINDOW_HEIGHT / (COURT_TOP - COURT_BOTTOM);
+
+constexpr char TRACE_FILEPATH[] = "pong_trace.json"; // written on exit and whenever 'P' is pressed
+constexpr char FRAME_STATS_FILEPATH[] = "frame_times.csv"; // one row per frame
+constexpr char DEFAULT_RECORDING_FILEPATH[] = "pong_inputs.rec";
+
+constexpr char HEADLESS_FLAG[]       = "--headless",
+               BATCH_FLAG[]          = "--batch",
+               OFFSCREEN_FLAG[]      = "--offscreen",
+               OFFSCREEN_CORE_FLAG[] = "--offscreen-core",
+               RECORD_FLAG[]         = "--record",
+               REPLAY_FLAG[]         = "--replay",
+               NETPLAY_FLAG[]        = "--netplay",
+               BROADCAST_FLAG[]      = "--broadcast",
+               WATCH_FLAG[]          = "--watch";
+constexpr int DEFAULT_HEADLESS_TICKS = 10000000,
+              DEFAULT_BATCH_MATCHES  = 100000,
+              DEFAULT_BATCH_TICKS    = 1000,
+              BATCH_CHUNK_SIZE       = 4096, // matches per work item, a multiple of the SIMD width
+              DEFAULT_OFFSCREEN_FRAMES = 600,
+              DEFAULT_REPLAY_RUNS    = 1000,
+              TICKS_PER_BROADCAST    = 2; // 60 snapshots a second, as many as a viewer draws frames
+constexpr float OFFSCREEN_FRAME_TIME = 1.0f / 60.0f; // simulated time between offscreen frames
+
+// netplay is two copies of the game on one machine: player 1 listens on the first port, player 2 on the second
+constexpr char NETPLAY_HOST[] = "127.0.0.1";
+constexpr uint16_t NETPLAY_PORTS[2] = { 47001, 47002 };
+constexpr double NETPLAY_LINGER_TIME = 1.0; // seconds we keep answering the peer after the match ends
+
+// --broadcast serves spectators here, --watch connects to it
+constexpr char BROADCAST_HOST[] = "127.0.0.1";
+constexpr uint16_t BROADCAST_PORT = 47100;
+constexpr double BROADCAST_LOG_INTERVAL = 5.0; // seconds between --broadcast's stats lines
+
+// the whole game state (paddles, ball, single-player switch) lives in here now
+PongSim g_sim = PongSim();
+PongInputs g_inputs = PongInputs();
+
+// set by --record, every step's inputs get logged and saved there on exit
+const char *g_recording_filepath = nullptr;
+InputRecorder g_input_recorder = InputRecorder();
+
+// set by --netplay, the steps come out of the rollback session and g_sim is just its latest state
+bool g_is_netplay = false;
+RollbackSession g_rollback = RollbackSession();
+UdpSocket g_netplay_socket;
+double g_netplay_end_time = -1.0; // when to quit, once both sides agree the match is over
+
+// set by --watch, g_sim is whatever the broadcast last sent and update() never runs
+bool g_is_watching = false;
+BroadcastViewer g_broadcast_viewer;
 
 
 SDL_Window* g_display_window;
 AppStatus g_app_status = RUNNING;
 ShaderProgram g_shader_program = ShaderProgram();
 
+SpriteBatch g_sprite_batch = SpriteBatch();
+
 glm::mat4 g_view_matrix,
-            g_bg_matrix,
-            g_cat1_matrix,
-            g_cat2_matrix,
-            g_ball_matrix,
             g_projection_matrix;
 
+CameraBuffer g_camera_buffer = CameraBuffer();
+bool g_is_camera_buffered = false;
+
+FrameStats g_frame_stats = FrameStats();
+StatsHud g_stats_hud = StatsHud();
+float g_swap_ms = 0.0f; // how long the last SDL_GL_SwapWindow took
+
 float g_previous_ticks = 0.0f;
+float g_accumulator = 0.0f;
 
 glm::vec3 g_rotation_bg    = glm::vec3(0.0f, 0.0f, 0.0f),
             g_rotation_cat1    = glm::vec3(0.0f, 0.0f, 0.0f),
             g_rotation_cat2    = glm::vec3(0.0f, 0.0f, 0.0f),
             g_rotation_ball    = glm::vec3(0.0f, 0.0f, 0.0f);
 
+// when the atlas is in use these all hold the atlas texture, and the UV rects pick out each sprite
 GLuint g_bg_texture_id,
        g_cat1_texture_id,
        g_cat2_texture_id,
        g_ball_texture_id;
 
+glm::vec4 g_bg_uv   = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f),
+          g_cat1_uv = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f),
+          g_cat2_uv = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f),
+          g_ball_uv = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f);
+
+TextureAtlas g_atlas = TextureAtlas();
+TextureCache g_texture_cache = TextureCache();
 
-GLuint load_texture(const char* filepath)
-{
-    // STEP 1: Loading the image file
-    int width, height, number_of_components;
-    unsigned char* image = stbi_load(filepath, &width, &height, &number_of_components, STBI_rgb_alpha);
 
-    if (image == NULL)
+GLuint upload_texture(const Image &image)
+{
+    // STEP 1: Making sure the image file actually loaded
+    if (image.empty())
     {
         LOG("Unable to load image. Make sure the path is correct.");
         assert(false);
@@ -117,21 +192,124 @@ GLuint load_texture(const char* filepath)
     GLuint textureID;
     glGenTextures(NUMBER_OF_TEXTURES, &textureID);
     glBindTexture(GL_TEXTURE_2D, textureID);
-    glTexImage2D(GL_TEXTURE_2D, LEVEL_OF_DETAIL, GL_RGBA, width, height, TEXTURE_BORDER, GL_RGBA, GL_UNSIGNED_BYTE, image);
+    glTexImage2D(GL_TEXTURE_2D, LEVEL_OF_DETAIL, GL_RGBA, image.width, image.height, TEXTURE_BORDER, GL_RGBA, GL_UNSIGNED_BYTE, image.data());
 
     // STEP 3: Setting our texture filter parameters
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 
-    // STEP 4: Releasing our file from memory and returning our texture id
-    stbi_image_free(image);
-
+    // STEP 4: Returning our texture id, the caller still owns the pixels
     return textureID;
 }
 
 
+// no point keeping more texels than end up on screen, so sprites are shrunk to the pixels they cover
+std::future<Image> load_sprite(const char *filepath, const glm::vec3 &scale)
+{
+    return g_texture_cache.load_async(filepath, (int) std::ceil(std::fabs(scale.x) * PIXELS_PER_UNIT_X),
+                                                (int) std::ceil(std::fabs(scale.y) * PIXELS_PER_UNIT_Y));
+}
+
+
+void load_textures()
+{
+    PROFILE_ZONE("load_textures");
+
+    // all four decode at the same time, only the uploads below have to happen on this (the GL) thread
+    std::future<Image> bg_loading   = load_sprite(BG_SPRITE_FILEPATH, BG_SCALE),
+                       cat1_loading = load_sprite(CAT1_SPRITE_FILEPATH, INIT_SCALE),
+                       cat2_loading = load_sprite(CAT2_SPRITE_FILEPATH, INIT_SCALE),
+                       ball_loading = load_sprite(BALL_SPRITE_FILEPATH, BALL_SCALE);
+
+    Image bg_image   = bg_loading.get(),
+          cat1_image = cat1_loading.get(),
+          cat2_image = cat2_loading.get(),
+          ball_image = ball_loading.get();
+
+    size_t kept_bytes = bg_image.size() + cat1_image.size() + cat2_image.size() + ball_image.size();
+    LOG("Loaded sprites (" << g_texture_cache.get_hits() << " from cache, " << g_texture_cache.get_misses()
+        << " decoded): " << kept_bytes / 1024 << " KB, downscaling saved "
+        << g_texture_cache.get_bytes_saved() / 1024 << " KB");
+
+    // pack everything into one texture so the whole scene needs a single bind
+    int bg_sprite   = g_atlas.add(bg_image),
+        cat1_sprite = g_atlas.add(cat1_image),
+        cat2_sprite = g_atlas.add(cat2_image),
+        ball_sprite = g_atlas.add(ball_image);
+
+    GLint max_texture_size = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_texture_size);
+
+    if (!bg_image.empty() && !cat1_image.empty() && !cat2_image.empty() &&
+        !ball_image.empty() && g_atlas.build(max_texture_size))
+    {
+        GLuint atlas_texture_id = g_atlas.upload();
+        LOG("Packed sprites into a " << g_atlas.get_width() << "x" << g_atlas.get_height() << " atlas");
+
+        g_bg_texture_id   = g_cat1_texture_id = g_cat2_texture_id = g_ball_texture_id = atlas_texture_id;
+        g_bg_uv   = g_atlas.get_uv_rect(bg_sprite);
+        g_cat1_uv = g_atlas.get_uv_rect(cat1_sprite);
+        g_cat2_uv = g_atlas.get_uv_rect(cat2_sprite);
+        g_ball_uv = g_atlas.get_uv_rect(ball_sprite);
+        return;
+    }
+
+    // doesn't fit in one texture on this GPU, fall back to one texture per sprite
+    g_bg_texture_id   = upload_texture(bg_image);
+    g_cat1_texture_id = upload_texture(cat1_image);
+    g_cat2_texture_id = upload_texture(cat2_image);
+    g_ball_texture_id = upload_texture(ball_image);
+}
+
+
+// everything past getting a context, shared by the window and --offscreen
+void initialise_gl()
+{
+    glViewport(VIEWPORT_X, VIEWPORT_Y, VIEWPORT_WIDTH, VIEWPORT_HEIGHT);
+
+    bool is_glsl_330 = gl_version_at_least(3, 3);
+
+    // with uniform blocks the camera goes up once a frame for every program, not per program
+    g_is_camera_buffered = is_glsl_330 || CameraBuffer::is_supported();
+    if (is_glsl_330) g_shader_program.load(V_SHADER_330_PATH, F_SHADER_330_PATH, CAMERA_BLOCK_330_PREAMBLE);
+    else             g_shader_program.load(V_SHADER_PATH, F_SHADER_PATH, g_is_camera_buffered ? CAMERA_BLOCK_PREAMBLE : "");
+    LOG("Shader program (GLSL " << (is_glsl_330 ? "3.30" : "1.10") << ") "
+        << (g_shader_program.is_from_binary_cache() ? "loaded from the binary cache" : "compiled from source"));
+
+    g_view_matrix       = glm::mat4(1.0f);
+    g_projection_matrix = glm::ortho(-5.0f, 5.0f, -3.75f, 3.75f, -1.0f, 1.0f);
+
+    if (g_is_camera_buffered)
+    {
+        g_camera_buffer.initialise();
+        g_camera_buffer.attach(g_shader_program);
+    }
+    else
+    {
+        g_shader_program.set_projection_matrix(g_projection_matrix);
+        g_shader_program.set_view_matrix(g_view_matrix);
+    }
+
+    g_shader_program.use();
+
+    glClearColor(BG_RED, BG_BLUE, BG_GREEN, BG_OPACITY);
+
+    load_textures();
+
+    g_sprite_batch.initialise(g_shader_program);
+
+    g_stats_hud.initialise();
+
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+}
+
+
 void initialise()
 {
+    Profiler::set_thread_name("main");
+    PROFILE_ZONE("initialise");
+
     // Initialise video and joystick subsystems
     SDL_Init(SDL_INIT_VIDEO);
 
@@ -142,6 +320,7 @@ void initialise()
 
     SDL_GLContext context = SDL_GL_CreateContext(g_display_window);
     SDL_GL_MakeCurrent(g_display_window, context);
+    ShaderProgram::reset_bound_program();
 
     if (g_display_window == nullptr)
     {
@@ -154,41 +333,14 @@ void initialise()
     glewInit();
 #endif
 
-    glViewport(VIEWPORT_X, VIEWPORT_Y, VIEWPORT_WIDTH, VIEWPORT_HEIGHT);
-
-    g_shader_program.load(V_SHADER_PATH, F_SHADER_PATH);
-
-    g_bg_matrix       = glm::mat4(1.0f);
-    g_cat1_matrix       = glm::mat4(1.0f);
-    g_cat2_matrix       = glm::mat4(1.0f);
-    g_ball_matrix       = glm::mat4(1.0f);
-    g_view_matrix       = glm::mat4(1.0f);
-    g_projection_matrix = glm::ortho(-5.0f, 5.0f, -3.75f, 3.75f, -1.0f, 1.0f);
-
-    g_shader_program.set_projection_matrix(g_projection_matrix);
-    g_shader_program.set_view_matrix(g_view_matrix);
-
-    glUseProgram(g_shader_program.get_program_id());
-
-    glClearColor(BG_RED, BG_BLUE, BG_GREEN, BG_OPACITY);
-
-    g_bg_texture_id   = load_texture(BG_SPRITE_FILEPATH);
-    g_cat1_texture_id   = load_texture(CAT1_SPRITE_FILEPATH);
-    g_cat2_texture_id   = load_texture(CAT2_SPRITE_FILEPATH);
-    g_ball_texture_id   = load_texture(BALL_SPRITE_FILEPATH);
-    
-    // generating the background here so it isnt affected in the update fx with all the other items
-    g_bg_matrix = glm::translate(glm::mat4(1.0f), INIT_POS_BG);
-    g_bg_matrix = glm::scale(g_bg_matrix, BG_SCALE);
-
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    initialise_gl();
+    g_frame_stats.open_csv(FRAME_STATS_FILEPATH);
 }
 
 
-void process_input(float delta_time)
+void process_input()
 {
-    const float PADDLE_SPEED = 4.0f;
+    PROFILE_ZONE("process_input");
 
     // Poll events for quit and close events
     SDL_Event event;
@@ -198,164 +350,489 @@ void process_input(float delta_time)
         {
             g_app_status = TERMINATED;
         }
-        // 'T' key clicked will toggle single-player mode
+        // 'T' key clicked will toggle single-player mode on the next simulation step
         if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_t) {
-            is_single_player_mode = !is_single_player_mode;
+            g_inputs.toggle_single_player = true;
+        }
+        // 'H' shows or hides the frame time table
+        if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_h) {
+            g_stats_hud.toggle();
+        }
+        // 'P' saves what the profiler has seen so far
+        if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_p) {
+            if (Profiler::write_chrome_trace(TRACE_FILEPATH)) LOG("Wrote " << TRACE_FILEPATH);
         }
     }
 
     const Uint8 *key_state = SDL_GetKeyboardState(NULL);
 
-    // Cat1 (WASD Controls)
-    glm::vec3 cat1_movement = glm::vec3(0.0f);
-    if (key_state[SDL_SCANCODE_W] && g_cat1_position.y + INIT_POS_CAT1.y + 1.0f < 3.75f) {
-        cat1_movement.y = 1.0f;
-    } else if (key_state[SDL_SCANCODE_S] && g_cat1_position.y + INIT_POS_CAT1.y - 1.0f > -3.75f) {
-        cat1_movement.y = -1.0f;
+    // the paddles themselves are moved (and kept on screen) by step()
+    g_inputs.cat1_up   = key_state[SDL_SCANCODE_W];
+    g_inputs.cat1_down = key_state[SDL_SCANCODE_S];
+    g_inputs.cat2_up   = key_state[SDL_SCANCODE_UP];
+    g_inputs.cat2_down = key_state[SDL_SCANCODE_DOWN];
+}
+
+double seconds_now()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void update_netplay()
+{
+    // either set of keys moves your own cat, whichever side it's on
+    uint8_t bits = (g_inputs.cat1_up   || g_inputs.cat2_up   ? PADDLE_UP   : 0) |
+                   (g_inputs.cat1_down || g_inputs.cat2_down ? PADDLE_DOWN : 0);
+
+    double now = seconds_now();
+    exchange_packets(g_rollback, g_netplay_socket, now);
+    if (g_rollback.advance(bits)) exchange_packets(g_rollback, g_netplay_socket, now);
+
+    g_sim = g_rollback.get_state();
+
+    // a goal we only predicted could still be rolled back, wait until both sides agree on it. Then
+    // keep sending for a bit, the peer may still be missing our last inputs or acks
+    if (g_netplay_end_time < 0.0 && g_rollback.is_match_over()) g_netplay_end_time = now + NETPLAY_LINGER_TIME;
+    if (g_netplay_end_time >= 0.0 && now >= g_netplay_end_time) g_app_status = TERMINATED;
+}
+
+void update(float delta_time)
+{
+    PROFILE_ZONE("update");
+
+    if (g_is_netplay)
+    {
+        update_netplay();
+        return;
     }
 
-    // Updating Cat 1 position with player control
-    g_cat1_position += cat1_movement * PADDLE_SPEED * delta_time;
+    if (g_recording_filepath != nullptr) g_input_recorder.record(g_inputs);
+    step(g_sim, g_inputs, delta_time);
 
-    // Cat2 (Arrow Keys) allowed when game is NOT in single-player mode
-    if (!is_single_player_mode) {
-        glm::vec3 cat2_movement = glm::vec3(0.0f);
-        if (key_state[SDL_SCANCODE_UP] && g_cat2_position.y + INIT_POS_CAT2.y + 1.0f < 3.75f) {
-            cat2_movement.y = 1.0f;
-        } else if (key_state[SDL_SCANCODE_DOWN] && g_cat2_position.y + INIT_POS_CAT2.y - 1.0f > -3.75f) {
-            cat2_movement.y = -1.0f;
-        }
-        g_cat2_position += cat2_movement * PADDLE_SPEED * delta_time;
+    // the toggle is a single key press, so only the first step should see it
+    g_inputs.toggle_single_player = false;
+
+    if (g_sim.is_game_over) g_app_status = TERMINATED;
+}
+
+// a spectator's g_sim comes off the network instead of out of update()
+void watch_broadcast()
+{
+    PROFILE_ZONE("watch_broadcast");
+    if (g_broadcast_viewer.receive()) g_sim = dequantize_sim(g_broadcast_viewer.get_state());
+
+    if (!g_broadcast_viewer.is_connected())
+    {
+        LOG("The broadcast has ended");
+        g_app_status = TERMINATED;
     }
 }
 
-void update()
+void draw_scene()
+{
+    glClear(GL_COLOR_BUFFER_BIT);
+
+    if (g_is_camera_buffered) g_camera_buffer.update(g_view_matrix, g_projection_matrix, g_previous_ticks);
+
+    // every sprite is a translate + scale of the same quad, so they all go through one batch
+    g_sprite_batch.begin();
+    g_sprite_batch.draw(g_bg_texture_id, INIT_POS_BG, BG_SCALE, g_bg_uv);
+    g_sprite_batch.draw(g_cat1_texture_id, INIT_POS_CAT1 + g_sim.cat1_position, INIT_SCALE, g_cat1_uv);
+    g_sprite_batch.draw(g_cat2_texture_id, INIT_POS_CAT2 + g_sim.cat2_position, INIT_SCALE, g_cat2_uv);
+    g_sprite_batch.draw(g_ball_texture_id, g_sim.ball_position, BALL_SCALE, g_ball_uv);
+    g_stats_hud.draw(g_sprite_batch, g_frame_stats, glm::vec2(COURT_LEFT, COURT_TOP),
+                     glm::vec2(1.0f / PIXELS_PER_UNIT_X, 1.0f / PIXELS_PER_UNIT_Y));
+    g_sprite_batch.flush();
+}
+
+void render()
 {
-    /* Delta time calculations */
-    float ticks = (float) SDL_GetTicks() / MILLISECONDS_IN_SECOND;
-    float delta_time = ticks - g_previous_ticks;
-    g_previous_ticks = ticks;
+    PROFILE_ZONE("render");
 
-    g_ball_position += g_ball_velocity * g_ball_speed * delta_time;
+    draw_scene();
 
-    // Handle ball collision with Paddle 1 aka Cat 1
-    if (g_ball_position.x - 0.5f < g_cat1_position.x + INIT_POS_CAT1.x + 0.5f &&
-        g_ball_position.y < g_cat1_position.y + INIT_POS_CAT1.y + 1.0f &&
-        g_ball_position.y > g_cat1_position.y + INIT_POS_CAT1.y - 1.0f)
+    PROFILE_ZONE("swap");
+    auto swap_start = std::chrono::steady_clock::now();
+    SDL_GL_SwapWindow(g_display_window);
+    g_swap_ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - swap_start).count();
+}
+
+
+void shutdown_gl()
+{
+    const ShaderCallStats &shader_calls = ShaderProgram::get_stats();
+    LOG("Shader state calls: " << shader_calls.issued << " issued, " << shader_calls.skipped << " skipped as redundant");
+
+    g_stats_hud.cleanup();
+    g_sprite_batch.cleanup();
+    g_atlas.cleanup();
+    if (g_is_camera_buffered) g_camera_buffer.cleanup();
+    g_shader_program.cleanup();
+}
+
+void shutdown()
+{
+    for (int series = 0; series < FrameStats::SERIES_COUNT; series++)
     {
-        g_ball_velocity.x = -g_ball_velocity.x;
+        FrameStats::Percentiles percentiles = g_frame_stats.get_percentiles((FrameStats::Series) series);
+        LOG(FRAME_STATS_SERIES_NAMES[series] << " ms over the last " << FrameStats::WINDOW << " frames: p50 " << percentiles.p50
+            << ", p95 " << percentiles.p95 << ", p99 " << percentiles.p99 << ", max " << percentiles.max);
     }
+    g_frame_stats.close_csv();
+
+    if (Profiler::write_chrome_trace(TRACE_FILEPATH)) LOG("Wrote " << TRACE_FILEPATH);
 
-    // Handle ball collision with Paddle 2 aka Cat 2
-    if (g_ball_position.x + 0.5f > g_cat2_position.x + INIT_POS_CAT2.x - 0.5f &&
-        g_ball_position.y < g_cat2_position.y + INIT_POS_CAT2.y + 1.0f &&
-        g_ball_position.y > g_cat2_position.y + INIT_POS_CAT2.y - 1.0f)
+    if (g_recording_filepath != nullptr)
     {
-        g_ball_velocity.x = -g_ball_velocity.x;
+        if (g_input_recorder.save(g_recording_filepath, g_sim)) {
+            LOG("Recorded " << g_input_recorder.get_tick_count() << " ticks of input to " << g_recording_filepath);
+        } else {
+            LOG("Unable to write " << g_recording_filepath);
+        }
     }
 
-    // Handle the ball colliding with top and bottom with bouncing off
-    if (g_ball_position.y + 0.5f > 3.75f || g_ball_position.y - 0.5f < -3.75f) {
-        g_ball_velocity.y = -g_ball_velocity.y;
+    if (g_is_netplay)
+    {
+        const RollbackSession::Stats &rollback = g_rollback.get_stats();
+        LOG("Netplay: " << rollback.rollbacks << " rollbacks, " << rollback.resimulated_ticks << " ticks re-simulated, deepest "
+            << rollback.deepest_rollback << ", slowest " << rollback.slowest_rollback_ms << " ms, " << rollback.stalls << " stalls");
     }
 
-    // if ball goes out of bounds horizontally, end game
-    if (g_ball_position.x + 0.5f > 5.0f || g_ball_position.x - 0.5f < -5.0f) {
-        g_app_status = TERMINATED;
-        return;
+    if (g_is_watching)
+    {
+        LOG("Watched " << g_broadcast_viewer.get_frames_received() << " snapshots, " << g_broadcast_viewer.get_bytes_received()
+            << " bytes");
     }
 
-    // single-player mode paddle 2 automated movement
-    if (is_single_player_mode) {
-        g_cat2_position.y += g_cat2_auto_direction * delta_time * 2.0f;
+    shutdown_gl();
+    SDL_Quit();
+}
+
 
-        // paddle moves opposite direction once it hits a boundary (top or bottom)
-        if (g_cat2_position.y + INIT_POS_CAT2.y + 1.0f > 3.75f ||
-            g_cat2_position.y + INIT_POS_CAT2.y - 1.0f < -3.75f) {
-            g_cat2_auto_direction *= -1.0f;
+// runs the simulation as fast as it can with no window, restarting the match whenever it ends
+int run_headless(long long total_ticks)
+{
+    PongSim sim = PongSim();
+    PongInputs inputs = PongInputs();
+    long long matches_finished = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (long long tick = 0; tick < total_ticks; tick++)
+    {
+        step(sim, inputs, FIXED_TIMESTEP);
+        if (sim.is_game_over)
+        {
+            sim = PongSim();
+            matches_finished++;
         }
     }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    LOG(total_ticks << " ticks, " << matches_finished << " matches in " << elapsed.count() << "s ("
+        << (long long) (total_ticks / elapsed.count()) << " ticks/s)");
+    return 0;
+}
+
+
+// plays a --record'ed match back run_count times with no window; every run has to end on the
+// recorded state, so this doubles as a determinism check for changes to the simulation
+int run_replay(const char *filepath, int run_count)
+{
+    InputReplay replay;
+    if (!replay.load(filepath)) return 1;
 
-    // Updating transformation matrices for ball and paddles
-    g_ball_matrix = glm::translate(glm::mat4(1.0f), g_ball_position);
-    g_ball_matrix = glm::scale(g_ball_matrix, BALL_SCALE);
+    double fastest = 0.0, total = 0.0;
+    for (int run = 0; run < run_count; run++)
+    {
+        PROFILE_ZONE("replay");
+        PongSim sim = PongSim();
+        replay.rewind();
 
-    g_cat1_matrix = glm::translate(glm::mat4(1.0f), INIT_POS_CAT1 + g_cat1_position);
-    g_cat1_matrix = glm::scale(g_cat1_matrix, INIT_SCALE);
+        auto start = std::chrono::steady_clock::now();
+        for (long long tick = 0; tick < replay.get_tick_count(); tick++)
+        {
+            step(sim, replay.next(), FIXED_TIMESTEP);
+        }
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
 
-    g_cat2_matrix = glm::translate(glm::mat4(1.0f), INIT_POS_CAT2 + g_cat2_position);
-    g_cat2_matrix = glm::scale(g_cat2_matrix, INIT_SCALE);
+        if (hash_state(sim) != replay.get_final_hash())
+        {
+            LOG("Replay " << run << " of " << filepath << " diverged from the recording");
+            return 1;
+        }
+        fastest = run == 0 || elapsed < fastest ? elapsed : fastest;
+        total  += elapsed;
+    }
+
+    LOG(run_count << " replays of " << replay.get_tick_count() << " ticks, all matching the recording; fastest "
+        << fastest * 1e6 << "us, mean " << total / run_count * 1e6 << "us");
+
+    if (Profiler::write_chrome_trace(TRACE_FILEPATH)) LOG("Wrote " << TRACE_FILEPATH);
+    return 0;
 }
 
 
+// cat1 for the broadcast matches (cat2 is the single-player AI): heads for where the ball will
+// reach it, and waits in the middle while it's going the other way
+PongInputs broadcast_bot_inputs(const PongSim &state)
+{
+    float paddle = state.cat1_position.y + INIT_POS_CAT1.y,
+          target = predict_intercept_y(state.ball_position.x, state.ball_position.y,
+                                       state.ball_velocity.x, state.ball_velocity.y, CAT1_CONTACT_X);
+
+    PongInputs inputs;
+    inputs.cat1_up   = target > paddle + 0.25f;
+    inputs.cat1_down = target < paddle - 0.25f;
+    return inputs;
+}
 
-void draw_object(glm::mat4 &object_g_model_matrix, GLuint &object_texture_id)
+// a fresh single-player match whenever the last one has ended
+void step_broadcast_match(PongSim &state)
 {
-    g_shader_program.set_model_matrix(object_g_model_matrix);
-    glBindTexture(GL_TEXTURE_2D, object_texture_id);
-    glDrawArrays(GL_TRIANGLES, 0, 6);
+    if (state.is_game_over)
+    {
+        state = PongSim();
+        state.is_single_player_mode = true;
+    }
+    step(state, broadcast_bot_inputs(state), FIXED_TIMESTEP);
 }
 
+// headless spectator server: plays bot matches back to back in real time and streams them to
+// anyone running --watch, for `seconds` (forever if 0)
+int run_broadcast(uint16_t port, double seconds)
+{
+    Profiler::set_thread_name("main");
+
+    BroadcastServer server;
+    if (!server.open(port)) return 1;
+    LOG("Broadcasting on " << BROADCAST_HOST << ":" << server.get_port() << ", run " << WATCH_FLAG << " to watch");
 
-void render()
+    PongSim sim = PongSim();
+    sim.is_single_player_mode = true;
+
+    double start = seconds_now(), next_tick = start, next_log = start + BROADCAST_LOG_INTERVAL;
+    size_t last_frames_queued = 0;
+    for (long long tick = 0; seconds <= 0.0 || next_tick - start < seconds; tick++)
+    {
+        step_broadcast_match(sim);
+        if (tick % TICKS_PER_BROADCAST == 0) server.broadcast(sim);
+
+        // viewers come, go and get sent their backlogs until the next tick is due
+        next_tick += FIXED_TIMESTEP;
+        for (double now = seconds_now(); now < next_tick; now = seconds_now())
+        {
+            server.poll((int) std::ceil((next_tick - now) * MILLISECONDS_IN_SECOND));
+        }
+
+        if (next_tick >= next_log)
+        {
+            const BroadcastServer::Stats &stats = server.get_stats();
+            LOG(server.get_viewer_count() << " viewers, " << (stats.frames_queued - last_frames_queued) / BROADCAST_LOG_INTERVAL
+                << " snapshots/s sent, " << stats.resyncs << " resyncs so far, mean broadcast "
+                << stats.broadcast_ms / stats.frames * 1000.0 << "us, slowest " << stats.slowest_broadcast_ms * 1000.0 << "us");
+            last_frames_queued = stats.frames_queued;
+            next_log += BROADCAST_LOG_INTERVAL;
+        }
+    }
+    return 0;
+}
+
+
+// same idea as run_headless, but steps a whole MatchBatch per tick spread over a thread pool
+int run_batch(size_t match_count, long long total_ticks, size_t thread_count)
 {
-    glClear(GL_COLOR_BUFFER_BIT);
+    MatchBatch batch(match_count);
+    WorkStealingPool pool(thread_count);
+    std::atomic<long long> matches_finished(0);
 
-    // Vertices
-    float vertices[] =
+    auto step_chunk = [&](size_t begin, size_t end)
     {
-        -0.5f, -0.5f, 0.5f, -0.5f, 0.5f, 0.5f,  // triangle 1
-        -0.5f, -0.5f, 0.5f, 0.5f, -0.5f, 0.5f   // triangle 2
+        PROFILE_ZONE("step_chunk");
+        batch.step_range(begin, end, nullptr, FIXED_TIMESTEP);
+
+        long long finished = 0;
+        for (size_t i = begin; i < end; i++)
+        {
+            if (batch.is_game_over[i])
+            {
+                batch.reset(i);
+                finished++;
+            }
+        }
+        matches_finished += finished;
     };
 
-    // Textures
-    float texture_coordinates[] =
+    auto start = std::chrono::steady_clock::now();
+    for (long long tick = 0; tick < total_ticks; tick++)
     {
-        0.0f, 1.0f, 1.0f, 1.0f, 1.0f, 0.0f,     // triangle 1
-        0.0f, 1.0f, 1.0f, 0.0f, 0.0f, 0.0f,     // triangle 2
-    };
+        pool.parallel_for(match_count, BATCH_CHUNK_SIZE, step_chunk);
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
 
-    glVertexAttribPointer(g_shader_program.get_position_attribute(), 2, GL_FLOAT, false,
-                          0, vertices);
-    glEnableVertexAttribArray(g_shader_program.get_position_attribute());
+    double match_ticks = (double) match_count * total_ticks;
+    LOG(match_count << " matches x " << total_ticks << " ticks, " << matches_finished << " finished in "
+        << elapsed.count() << "s on " << pool.get_thread_count() << " threads ("
+        << (long long) (match_ticks / elapsed.count()) << " match-ticks/s)");
+    pool.print_stats(std::cout);
 
-    glVertexAttribPointer(g_shader_program.get_tex_coordinate_attribute(), 2, GL_FLOAT,
-                          false, 0, texture_coordinates);
-    glEnableVertexAttribArray(g_shader_program.get_tex_coordinate_attribute());
+    if (Profiler::write_chrome_trace(TRACE_FILEPATH)) LOG("Wrote " << TRACE_FILEPATH);
+    return 0;
+}
 
-    // Bind texture
-    draw_object(g_bg_matrix, g_bg_texture_id);
-    draw_object(g_cat1_matrix, g_cat1_texture_id);
-    draw_object(g_cat2_matrix, g_cat2_texture_id);
-    draw_object(g_ball_matrix, g_ball_texture_id);
 
-    // We disable two attribute arrays now
-    glDisableVertexAttribArray(g_shader_program.get_position_attribute());
-    glDisableVertexAttribArray(g_shader_program.get_tex_coordinate_attribute());
+// renders frame_count frames into an offscreen framebuffer (no window, no SDL) and reports how
+// fast that went; with a ppm_directory every frame is also saved there for image comparisons.
+// --offscreen-core does the same on a GL 3.3 core profile context
+int run_offscreen(int frame_count, const char *ppm_directory, bool is_core_profile)
+{
+    Profiler::set_thread_name("main");
 
-    SDL_GL_SwapWindow(g_display_window);
-}
+    OffscreenContext context;
+    if (!context.create(WINDOW_WIDTH, WINDOW_HEIGHT, is_core_profile)) return 1;
 
+    LOG("Offscreen renderer: " << glGetString(GL_RENDERER) << ", " << glGetString(GL_VERSION));
+    initialise_gl();
 
-void shutdown() { SDL_Quit(); }
+    if (ppm_directory != nullptr) std::filesystem::create_directories(ppm_directory);
+
+    FrameStats stats;
+    double render_seconds = 0.0;
+    for (int frame = 0; frame < frame_count; frame++)
+    {
+        // same fixed steps as the real loop, fed a steady 60 fps and restarted whenever a match ends
+        auto simulation_start = std::chrono::steady_clock::now();
+        int simulation_steps = 0;
+        g_accumulator += OFFSCREEN_FRAME_TIME;
+        while (g_accumulator >= FIXED_TIMESTEP)
+        {
+            step(g_sim, g_inputs, FIXED_TIMESTEP);
+            if (g_sim.is_game_over) g_sim = PongSim();
+            g_accumulator -= FIXED_TIMESTEP;
+            simulation_steps++;
+        }
+        g_previous_ticks += OFFSCREEN_FRAME_TIME;
+        auto render_start = std::chrono::steady_clock::now();
+
+        {
+            PROFILE_ZONE("render");
+            draw_scene();
+            glFinish(); // nothing to swap, so wait for the frame to actually be drawn
+        }
+
+        auto render_end = std::chrono::steady_clock::now();
+        render_seconds += std::chrono::duration<double>(render_end - render_start).count();
+        stats.record(std::chrono::duration<float, std::milli>(render_end - simulation_start).count(), 0.0f,
+                     std::chrono::duration<float, std::milli>(render_start - simulation_start).count(), simulation_steps);
+
+        if (ppm_directory != nullptr)
+        {
+            char filepath[512];
+            snprintf(filepath, sizeof(filepath), "%s/frame_%05d.ppm", ppm_directory, frame);
+            if (!context.write_ppm(filepath)) LOG("Unable to write " << filepath);
+        }
+    }
+
+    FrameStats::Percentiles frame_ms = stats.get_percentiles(FrameStats::CPU_FRAME);
+    LOG(frame_count << " frames rendered in " << render_seconds << "s (" << frame_count / render_seconds
+        << " fps), frame ms p50 " << frame_ms.p50 << ", p99 " << frame_ms.p99 << ", max " << frame_ms.max);
+
+    shutdown_gl();
+    context.destroy();
+    return 0;
+}
 
 
 int main(int argc, char* argv[])
 {
+    if (argc > 1 && strcmp(argv[1], HEADLESS_FLAG) == 0)
+    {
+        return run_headless(argc > 2 ? atoll(argv[2]) : DEFAULT_HEADLESS_TICKS);
+    }
+    if (argc > 1 && strcmp(argv[1], BATCH_FLAG) == 0)
+    {
+        return run_batch(argc > 2 ? (size_t) atoll(argv[2]) : DEFAULT_BATCH_MATCHES,
+                         argc > 3 ? atoll(argv[3]) : DEFAULT_BATCH_TICKS,
+                         argc > 4 ? (size_t) atoll(argv[4]) : std::thread::hardware_concurrency());
+    }
+
+    if (argc > 1 && (strcmp(argv[1], OFFSCREEN_FLAG) == 0 || strcmp(argv[1], OFFSCREEN_CORE_FLAG) == 0))
+    {
+        return run_offscreen(argc > 2 ? atoi(argv[2]) : DEFAULT_OFFSCREEN_FRAMES, argc > 3 ? argv[3] : nullptr,
+                             strcmp(argv[1], OFFSCREEN_CORE_FLAG) == 0);
+    }
+
+    if (argc > 1 && strcmp(argv[1], REPLAY_FLAG) == 0)
+    {
+        return run_replay(argc > 2 ? argv[2] : DEFAULT_RECORDING_FILEPATH, argc > 3 ? atoi(argv[3]) : DEFAULT_REPLAY_RUNS);
+    }
+    if (argc > 1 && strcmp(argv[1], NETPLAY_FLAG) == 0)
+    {
+        // --netplay <1|2> [latency ms] [loss %], run one of each
+        int player = argc > 2 && atoi(argv[2]) == 2 ? 1 : 0;
+        if (!g_netplay_socket.open(NETPLAY_PORTS[player], NETPLAY_HOST, NETPLAY_PORTS[1 - player])) return 1;
+
+        LinkConditions conditions;
+        conditions.latency = argc > 3 ? atof(argv[3]) / MILLISECONDS_IN_SECOND : 0.0;
+        conditions.loss    = argc > 4 ? (float) atof(argv[4]) / 100.0f : 0.0f;
+        g_netplay_socket.set_conditions(conditions);
+
+        g_rollback.start(player);
+        g_is_netplay = true;
+    }
+    if (argc > 1 && strcmp(argv[1], BROADCAST_FLAG) == 0)
+    {
+        // --broadcast [port] [seconds]
+        return run_broadcast(argc > 2 ? (uint16_t) atoi(argv[2]) : BROADCAST_PORT, argc > 3 ? atof(argv[3]) : 0.0);
+    }
+    if (argc > 1 && strcmp(argv[1], WATCH_FLAG) == 0)
+    {
+        // --watch [port], the match is whatever a --broadcast is sending
+        if (!g_broadcast_viewer.connect(BROADCAST_HOST, argc > 2 ? (uint16_t) atoi(argv[2]) : BROADCAST_PORT)) return 1;
+        g_is_watching = true;
+    }
+    if (argc > 1 && strcmp(argv[1], RECORD_FLAG) == 0)
+    {
+        g_recording_filepath = argc > 2 ? argv[2] : DEFAULT_RECORDING_FILEPATH;
+    }
+
     initialise();
 
     while (g_app_status == RUNNING)
     {
+        PROFILE_ZONE("frame");
+        auto frame_start = std::chrono::steady_clock::now();
+
         // Calculate delta_time at the beginning of the loop
         float ticks = (float) SDL_GetTicks() / MILLISECONDS_IN_SECOND;
         float delta_time = ticks - g_previous_ticks;
 
-        process_input(delta_time);
-        update();
+        g_previous_ticks = ticks;
+
+        process_input();
+
+        // the simulation only ever moves in FIXED_TIMESTEP sized steps, leftover time carries over
+        auto simulation_start = std::chrono::steady_clock::now();
+        int simulation_steps = 0;
+        if (g_is_watching)
+        {
+            watch_broadcast();
+        }
+        else
+        {
+            g_accumulator += delta_time < MAX_FRAME_TIME ? delta_time : MAX_FRAME_TIME;
+            while (g_accumulator >= FIXED_TIMESTEP && g_app_status == RUNNING)
+            {
+                update(FIXED_TIMESTEP);
+                g_accumulator -= FIXED_TIMESTEP;
+                simulation_steps++;
+            }
+        }
+        float simulation_ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - simulation_start).count();
+
         render();
 
-        // Update g_previous_ticks after processing
-        g_previous_ticks = ticks;
+        float frame_ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - frame_start).count();
+        g_frame_stats.record(frame_ms - g_swap_ms, g_swap_ms, simulation_ms, simulation_steps);
     }
 
     shutdown();
@@ -0,0 +1,11 @@
+#version 330 core
+// fragment_textured.glsl for core profiles, which dropped varying, texture2D and gl_FragColor
+
+uniform sampler2D diffuse;
+in vec2 texCoordVar;
+
+out vec4 fragColor;
+
+void main() {
+    fragColor = texture(diffuse, texCoordVar);
+}
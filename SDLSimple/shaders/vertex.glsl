@@ -1,8 +1,18 @@
 attribute vec4 position;
 
 uniform mat4 modelMatrix;
+#ifdef CAMERA_BLOCK
+// filled in once per frame by CameraBuffer, shared with every other program
+layout(std140) uniform Camera
+{
+    mat4 viewMatrix;
+    mat4 projectionMatrix;
+    float time;
+};
+#else
 uniform mat4 viewMatrix;
 uniform mat4 projectionMatrix;
+#endif
 
 void main()
 {
@@ -0,0 +1,32 @@
+#version 330 core
+// vertex_instanced.glsl for core profiles, which dropped attribute/varying
+
+in vec4 position;
+in vec2 texCoord;
+
+// one of each per sprite instance
+in vec4 instanceRect; // centre x, centre y, scale x, scale y
+in vec4 instanceUV;   // u, v, width, height of the sprite's area of the texture
+
+#ifdef CAMERA_BLOCK
+// filled in once per frame by CameraBuffer, shared with every other program
+layout(std140) uniform Camera
+{
+    mat4 viewMatrix;
+    mat4 projectionMatrix;
+    float time;
+};
+#else
+uniform mat4 viewMatrix;
+uniform mat4 projectionMatrix;
+#endif
+
+out vec2 texCoordVar;
+
+void main()
+{
+    // same as modelMatrix * position for a translate + scale model matrix
+    vec4 p = viewMatrix * vec4(position.xy * instanceRect.zw + instanceRect.xy, 0.0, 1.0);
+    texCoordVar = instanceUV.xy + texCoord * instanceUV.zw;
+    gl_Position = projectionMatrix * p;
+}
@@ -2,8 +2,18 @@ attribute vec4 position;
 attribute vec2 texCoord;
 
 uniform mat4 modelMatrix;
+#ifdef CAMERA_BLOCK
+// filled in once per frame by CameraBuffer, shared with every other program
+layout(std140) uniform Camera
+{
+    mat4 viewMatrix;
+    mat4 projectionMatrix;
+    float time;
+};
+#else
 uniform mat4 viewMatrix;
 uniform mat4 projectionMatrix;
+#endif
 
 varying vec2 texCoordVar;
 
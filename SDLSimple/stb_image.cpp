@@ -0,0 +1,4 @@
+// stb_image's implementation, on its own so every target that decodes images links the same copy
+#define STB_IMAGE_IMPLEMENTATION
+#define STBI_NO_FAILURE_STRINGS // the failure string is one unguarded global, and sprites decode on several threads
+#include "stb_image.h"
@@ -0,0 +1,910 @@
+// Checks for the parts of pong_core that can't be seen from the game window. No SDL and no GL,
+// so they build and run anywhere pong_core does; CMake registers each one with ctest.
+//
+//   pong_tests               runs every check
+//   pong_tests <name>...     just those
+//   pong_tests --list        prints the names
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <new>
+#include <random>
+#include <vector>
+#include "VecEnv.h"
+#include "Rollback.h"
+#include "UdpSocket.h"
+#include "Broadcast.h"
+#include "SweptCollision.h"
+#include "MatchBatch.h"
+#include "CollisionKernel.h"
+#include "Snapshot.h"
+#include "InputRecording.h"
+
+// ---- counting every allocation in the process ----
+
+static std::atomic<size_t> g_allocations { 0 };
+
+void *operator new(size_t size)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *memory = malloc(size ? size : 1)) return memory;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *memory) noexcept { free(memory); }
+void operator delete(void *memory, size_t) noexcept { free(memory); }
+
+#define CHECK(condition) \
+    do { if (!(condition)) { printf("    failed: %s (line %d)\n", #condition, __LINE__); return false; } } while (0)
+
+// ---- VecEnv ----
+
+// buffers for one VecEnv, the way a training loop would hold them
+struct VecEnvBuffers
+{
+    std::vector<int8_t>  actions;
+    std::vector<float>   observations, rewards;
+    std::vector<uint8_t> dones;
+
+    explicit VecEnvBuffers(size_t env_count)
+        : actions(env_count * VecEnv::ACTIONS_PER_ENV), observations(env_count * VecEnv::OBSERVATION_SIZE),
+          rewards(env_count), dones(env_count) {}
+
+    void step(VecEnv &env) { env.step(actions.data(), observations.data(), rewards.data(), dones.data()); }
+};
+
+// step() mustn't allocate, threaded or not
+static bool test_vecenv_no_allocations()
+{
+    constexpr size_t ENV_COUNT = 4096, STEPS = 1000, WARM_UP_STEPS = 100;
+
+    for (size_t thread_count : { 1, 4 })
+    {
+        VecEnvSettings settings;
+        settings.thread_count      = thread_count;
+        settings.chunk_size        = 64; // plenty of chunks for the workers to steal
+        settings.max_episode_ticks = 600;
+
+        VecEnv env(ENV_COUNT, settings);
+        VecEnvBuffers buffers(ENV_COUNT);
+        for (size_t i = 0; i < buffers.actions.size(); i++) buffers.actions[i] = (int8_t) (i % 3) - 1;
+
+        // the workers name themselves for the profiler when they first start
+        env.reset(buffers.observations.data());
+        for (size_t step = 0; step < WARM_UP_STEPS; step++) buffers.step(env);
+
+        size_t before = g_allocations.load();
+        for (size_t step = 0; step < STEPS; step++) buffers.step(env);
+        size_t allocations = g_allocations.load() - before;
+
+        printf("    %zu thread(s): %zu allocations over %zu steps\n", thread_count, allocations, STEPS);
+        CHECK(allocations == 0);
+    }
+    return true;
+}
+
+// same actions, but the envs still play different rallies; and the same seed plays the same ones
+// on any number of threads
+static bool test_vecenv_serves()
+{
+    constexpr size_t ENV_COUNT = 256, STEPS = 2000;
+
+    std::vector<float> final_observations[2];
+    for (size_t run = 0; run < 2; run++)
+    {
+        VecEnvSettings settings;
+        settings.thread_count = run == 0 ? 1 : 4;
+        settings.chunk_size   = 16;
+
+        VecEnv env(ENV_COUNT, settings);
+        VecEnvBuffers buffers(ENV_COUNT);
+        env.reset(buffers.observations.data());
+
+        const float *observations = buffers.observations.data();
+        size_t same_as_first = 0;
+        for (size_t i = 1; i < ENV_COUNT; i++)
+        {
+            if (memcmp(observations, observations + i * VecEnv::OBSERVATION_SIZE, VecEnv::OBSERVATION_SIZE * sizeof(float)) == 0) same_as_first++;
+        }
+        CHECK(same_as_first < ENV_COUNT / 2);
+
+        for (size_t step = 0; step < STEPS; step++) buffers.step(env);
+        final_observations[run] = buffers.observations;
+    }
+    CHECK(final_observations[0] == final_observations[1]);
+    return true;
+}
+
+// ---- swept collisions ----
+
+// how a rally played out: which side let the ball through (0 for cat1, 1 for cat2, -1 if
+// neither in time) and how often it came off a paddle
+struct RallyOutcome
+{
+    int loser      = -1;
+    int paddle_hits = 0;
+};
+
+// plays `state` out with nobody touching the keys (so the paddles stay where they are) for up to
+// `seconds`, in steps of delta_time
+static RallyOutcome play_rally(PongSim state, float delta_time, float seconds)
+{
+    RallyOutcome outcome;
+    for (int tick = 0; tick < (int) (seconds / delta_time) && !state.is_game_over; tick++)
+    {
+        // at most one paddle is reached per step here, so a flip in x is a hit
+        float velocity_x = state.ball_velocity.x;
+        step(state, PongInputs(), delta_time);
+        if (!state.is_game_over && (state.ball_velocity.x > 0.0f) != (velocity_x > 0.0f)) outcome.paddle_hits++;
+    }
+    if (state.is_game_over) outcome.loser = state.ball_position.x < 0.0f ? 0 : 1;
+    return outcome;
+}
+
+// fast balls served at still paddles: at 1/15 s a step they move further than a paddle and the
+// ball are wide put together, which an overlap test would skip straight past. Sweeping, the rally
+// has to go the same way as at FIXED_TIMESTEP
+static bool test_swept_no_tunnelling()
+{
+    constexpr int   RALLY_COUNT = 2000;
+    constexpr float BALL_SPEED  = 40.0f, // 2.67 units a step at LONG_STEP, paddle + ball are 2 wide
+                    LONG_STEP   = 1.0f / 15.0f,
+                    SECONDS     = 10.0f;
+
+    std::mt19937 random(5);
+    std::uniform_real_distribution<float> serve_y(-3.0f, 3.0f), slope(-1.0f, 1.0f), paddle_y(-2.5f, 2.5f);
+
+    int goals = 0, hits = 0;
+    for (int rally = 0; rally < RALLY_COUNT; rally++)
+    {
+        PongSim state = PongSim();
+        state.ball_position   = glm::vec3(0.0f, serve_y(random), 0.0f);
+        state.ball_velocity   = glm::vec3(random() % 2 ? 1.0f : -1.0f, slope(random), 0.0f);
+        state.ball_speed      = BALL_SPEED;
+        state.cat1_position.y = paddle_y(random) - INIT_POS_CAT1.y;
+        state.cat2_position.y = paddle_y(random) - INIT_POS_CAT2.y;
+
+        RallyOutcome fixed = play_rally(state, FIXED_TIMESTEP, SECONDS),
+                     coarse = play_rally(state, LONG_STEP, SECONDS);
+        if (fixed.loser != coarse.loser || fixed.paddle_hits != coarse.paddle_hits)
+        {
+            printf("    rally %d: cat%d lost after %d hit(s) at 1/120 s, cat%d after %d at 1/15 s\n",
+                   rally, fixed.loser + 1, fixed.paddle_hits, coarse.loser + 1, coarse.paddle_hits);
+        }
+        CHECK(fixed.loser == coarse.loser);
+        CHECK(fixed.paddle_hits == coarse.paddle_hits);
+
+        goals += fixed.loser >= 0 ? 1 : 0;
+        hits  += fixed.paddle_hits;
+    }
+    printf("    %d rallies, %d ended in a goal, %d paddle hits\n", RALLY_COUNT, goals, hits);
+    CHECK(goals > 0 && hits > 0); // both ways a rally can go got tested
+    return true;
+}
+
+// hand-worked single steps where the arithmetic comes out exact
+static bool test_sweep_ball_edges()
+{
+    // into cat2's top corner: the top wall and the paddle face are reached at the same moment,
+    // both bounces happen and the ball goes straight back the way it came
+    {
+        float x = 2.0f, y = 2.25f, velocity_x = 1.0f, velocity_y = 1.0f;
+        CHECK(!sweep_ball(x, y, velocity_x, velocity_y, 4.0f, 0.0f, 2.5f, 0.5f));
+        CHECK(x == 2.0f && y == 2.25f);
+        CHECK(velocity_x == -1.0f && velocity_y == -1.0f);
+    }
+
+    // off the top wall and then cat2 within one step
+    {
+        float x = 0.0f, y = 2.25f, velocity_x = 1.0f, velocity_y = 1.0f;
+        CHECK(!sweep_ball(x, y, velocity_x, velocity_y, 4.0f, 0.0f, 1.0f, 1.0f));
+        CHECK(x == 2.0f && y == 0.25f);
+        CHECK(velocity_x == -1.0f && velocity_y == -1.0f);
+    }
+
+    // the same with cat1 off the bottom wall, mirrored
+    {
+        float x = 0.0f, y = -2.25f, velocity_x = -1.0f, velocity_y = -1.0f;
+        CHECK(!sweep_ball(x, y, velocity_x, velocity_y, 4.0f, -1.0f, 0.0f, 1.0f));
+        CHECK(x == -2.0f && y == -0.25f);
+        CHECK(velocity_x == 1.0f && velocity_y == 1.0f);
+    }
+
+    // off the wall but cat2 is lower down: the ball goes past the face and out
+    {
+        float x = 0.0f, y = 2.25f, velocity_x = 1.0f, velocity_y = 1.0f;
+        CHECK(sweep_ball(x, y, velocity_x, velocity_y, 4.0f, 0.0f, -2.0f, 1.5f));
+        CHECK(x == 6.0f && y == -1.75f);
+        CHECK(velocity_x == 1.0f && velocity_y == -1.0f);
+    }
+
+    // a ball behind cat2's face heading back into the court only bounces off the front of a paddle
+    {
+        float x = 3.5f, y = 0.0f, velocity_x = -1.0f, velocity_y = 0.0f;
+        CHECK(!sweep_ball(x, y, velocity_x, velocity_y, 1.0f, 0.0f, 0.0f, 1.0f));
+        CHECK(x == 2.5f && velocity_x == -1.0f);
+    }
+    return true;
+}
+
+// ---- the batched collision kernel ----
+
+// a match caught at a random moment: the ball anywhere from well inside the court to past a
+// paddle face or a wall, slow or fast enough to cross the court in a few steps, and some matches
+// already over or in single-player mode
+static PongSim random_match(std::mt19937 &random)
+{
+    std::uniform_real_distribution<float> ball_x(-4.5f, 4.5f), ball_y(-3.5f, 3.5f), direction(-1.0f, 1.0f),
+                                          speed(0.5f, 60.0f), paddle_y(-2.75f, 2.75f);
+    PongSim state = PongSim();
+    state.ball_position         = glm::vec3(ball_x(random), ball_y(random), 0.0f);
+    state.ball_velocity         = glm::vec3(direction(random), direction(random), 0.0f);
+    state.ball_speed            = speed(random);
+    state.cat1_position.y       = paddle_y(random) - INIT_POS_CAT1.y;
+    state.cat2_position.y       = paddle_y(random) - INIT_POS_CAT2.y;
+    state.is_single_player_mode = random() % 4 == 0;
+    state.is_game_over          = random() % 10 == 0;
+    return state;
+}
+
+static CollisionLanes lanes_of(MatchBatch &batch)
+{
+    return { batch.ball_x.data(), batch.ball_y.data(), batch.velocity_x.data(), batch.velocity_y.data(),
+             batch.ball_speed.data(), batch.cat1_y.data(), batch.cat2_y.data(), batch.is_game_over.data() };
+}
+
+static bool same_floats(const std::vector<float> &a, const std::vector<float> &b)
+{
+    return a.size() == b.size() && memcmp(a.data(), b.data(), a.size() * sizeof(float)) == 0;
+}
+
+// resolve_collisions() only vectorises the balls that hit nothing, so every lane has to come out
+// bit for bit what resolve_collisions_scalar() makes of it; and a whole MatchBatch::step() what
+// step() makes of each match on its own. The match count isn't a multiple of the SIMD width, so
+// the leftovers get checked too
+static bool test_collision_kernel()
+{
+    constexpr size_t MATCH_COUNT = 4099, STEPS = 240;
+    printf("    %s kernel\n", collision_kernel_name());
+
+    std::mt19937 random(3);
+    std::vector<PongSim> matches(MATCH_COUNT);
+    MatchBatch vectorised(MATCH_COUNT);
+    for (size_t i = 0; i < MATCH_COUNT; i++)
+    {
+        matches[i] = random_match(random);
+        vectorised.load(i, matches[i]);
+    }
+    MatchBatch scalar = vectorised;
+
+    // half the steps long enough for several bounces each
+    for (size_t step_index = 0; step_index < STEPS; step_index++)
+    {
+        float delta_time = step_index % 2 ? FIXED_TIMESTEP : 1.0f / 15.0f;
+        resolve_collisions(lanes_of(vectorised), 0, MATCH_COUNT, delta_time);
+        resolve_collisions_scalar(lanes_of(scalar), 0, MATCH_COUNT, delta_time);
+    }
+    CHECK(same_floats(vectorised.ball_x, scalar.ball_x));
+    CHECK(same_floats(vectorised.ball_y, scalar.ball_y));
+    CHECK(same_floats(vectorised.velocity_x, scalar.velocity_x));
+    CHECK(same_floats(vectorised.velocity_y, scalar.velocity_y));
+    CHECK(vectorised.is_game_over == scalar.is_game_over);
+
+    // the whole rules, paddles and AI included, against step()
+    MatchBatch batch(MATCH_COUNT);
+    for (size_t i = 0; i < MATCH_COUNT; i++) batch.load(i, matches[i]);
+
+    std::vector<PongInputs> inputs(MATCH_COUNT);
+    for (size_t step_index = 0; step_index < STEPS; step_index++)
+    {
+        for (PongInputs &input : inputs)
+        {
+            uint32_t keys = random();
+            input.cat1_up   = keys & 1;
+            input.cat1_down = keys & 2;
+            input.cat2_up   = keys & 4;
+            input.cat2_down = keys & 8;
+            input.toggle_single_player = keys % 97 == 0;
+        }
+
+        float delta_time = step_index % 2 ? FIXED_TIMESTEP : 1.0f / 15.0f;
+        batch.step(inputs.data(), delta_time);
+        for (size_t i = 0; i < MATCH_COUNT; i++) step(matches[i], inputs[i], delta_time);
+    }
+
+    size_t different = 0, finished = 0;
+    for (size_t i = 0; i < MATCH_COUNT; i++)
+    {
+        different += hash_state(batch.store(i)) != hash_state(matches[i]) ? 1 : 0;
+        finished  += matches[i].is_game_over ? 1 : 0;
+    }
+    printf("    %zu of %zu matches over after %zu steps, %zu different from step()\n", finished, MATCH_COUNT, STEPS, different);
+    CHECK(different == 0);
+    CHECK(finished > 0 && finished < MATCH_COUNT);
+    return true;
+}
+
+// ---- netplay ----
+
+// not the game's own netplay ports, so a match on this machine doesn't get in the way
+constexpr char     NETPLAY_TEST_HOST[]     = "127.0.0.1";
+constexpr uint16_t NETPLAY_TEST_PORTS[2]   = { 47011, 47012 };
+
+// two sockets on localhost talking to each other with 100 ms latency (plus up to half that again
+// of jitter) and 5% loss on every packet
+static bool open_netplay_sockets(UdpSocket (&sockets)[2])
+{
+    for (int player = 0; player < 2; player++)
+    {
+        if (!sockets[player].open(NETPLAY_TEST_PORTS[player], NETPLAY_TEST_HOST, NETPLAY_TEST_PORTS[1 - player])) return false;
+
+        LinkConditions conditions;
+        conditions.latency = 0.1;
+        conditions.jitter  = 0.05;
+        conditions.loss    = 0.05f;
+        conditions.seed    = player + 1;
+        sockets[player].set_conditions(conditions);
+    }
+    return true;
+}
+
+// a player steering towards the ball as they see it, give or take a bit, and holding each
+// decision for a random number of ticks
+struct NetplayBot
+{
+    uint8_t held = 0;
+    int     hold_ticks = 0;
+
+    uint8_t choose(const PongSim &state, int player, std::mt19937 &random)
+    {
+        if (--hold_ticks > 0) return held;
+
+        float paddle = player == 0 ? state.cat1_position.y + INIT_POS_CAT1.y : state.cat2_position.y + INIT_POS_CAT2.y,
+              target = state.ball_position.y + std::uniform_real_distribution<float>(-1.5f, 1.5f)(random);
+        held = target > paddle + 0.25f ? PADDLE_UP : (target < paddle - 0.25f ? PADDLE_DOWN : 0);
+        hold_ticks = 1 + (int) (random() % 24);
+        return held;
+    }
+};
+
+// what the two players' bits make of a tick
+static PongInputs netplay_inputs(uint8_t cat1, uint8_t cat2)
+{
+    PongInputs inputs;
+    inputs.cat1_up   = cat1 & PADDLE_UP;
+    inputs.cat1_down = cat1 & PADDLE_DOWN;
+    inputs.cat2_up   = cat2 & PADDLE_UP;
+    inputs.cat2_down = cat2 & PADDLE_DOWN;
+    return inputs;
+}
+
+// both players of a netplay match in one process, over open_netplay_sockets(), with bots for
+// players. Matches restart as soon as they end so rollbacks keep happening all the way through.
+// Once both have played every tick and heard every input from the other, their states have to
+// match a plain re-run of the inputs that were actually played, bit for bit.
+static bool test_netplay_loopback()
+{
+    constexpr long long TICK_COUNT = 12000;
+
+    RollbackSession sessions[2];
+    UdpSocket sockets[2];
+    std::vector<uint8_t> played[2];
+    CHECK(open_netplay_sockets(sockets));
+    for (int player = 0; player < 2; player++)
+    {
+        sessions[player].start(player, PongSim(), true);
+        played[player].reserve(TICK_COUNT);
+    }
+
+    std::mt19937 random(7);
+    NetplayBot bots[2];
+
+    // a simulated clock, so the injected latency is in game time however fast this runs
+    double now = 0.0;
+    for (long long iteration = 0; iteration < TICK_COUNT * 10; iteration++)
+    {
+        bool is_finished = true;
+        for (int player = 0; player < 2; player++)
+        {
+            RollbackSession &session = sessions[player];
+            if (session.get_tick() < TICK_COUNT)
+            {
+                uint8_t bits = bots[player].choose(session.get_state(), player, random);
+                if (session.advance(bits)) played[player].push_back(bits);
+            }
+
+            exchange_packets(session, sockets[player], now);
+            is_finished &= session.get_tick() == TICK_COUNT && session.get_confirmed_tick() == TICK_COUNT;
+        }
+        if (is_finished) break;
+        now += FIXED_TIMESTEP;
+    }
+    CHECK((long long) played[0].size() == TICK_COUNT && (long long) played[1].size() == TICK_COUNT);
+
+    PongSim reference = PongSim();
+    int matches_finished = 0;
+    for (long long tick = 0; tick < TICK_COUNT; tick++)
+    {
+        step(reference, netplay_inputs(played[0][tick], played[1][tick]), FIXED_TIMESTEP);
+
+        if (reference.is_game_over)
+        {
+            reference = PongSim();
+            matches_finished++;
+        }
+    }
+    printf("    %d match(es) finished over %lld ticks\n", matches_finished, TICK_COUNT);
+    CHECK(matches_finished > 0); // otherwise the restart isn't being tested
+
+    for (int player = 0; player < 2; player++)
+    {
+        RollbackSession &session = sessions[player];
+        session.synchronise();
+
+        const RollbackSession::Stats &stats = session.get_stats();
+        printf("    player %d: %lld ticks (%lld confirmed), %zu rollbacks re-simulating %zu ticks (deepest %d), %zu stalls, "
+               "%zu packets sent, %zu dropped\n",
+               player + 1, session.get_tick(), session.get_confirmed_tick(), stats.rollbacks, stats.resimulated_ticks,
+               stats.deepest_rollback, stats.stalls, sockets[player].get_packets_sent(), sockets[player].get_packets_dropped());
+
+        CHECK(session.get_confirmed_tick() == TICK_COUNT);
+        CHECK(stats.rollbacks > 0);
+        CHECK(hash_state(session.get_state()) == hash_state(reference));
+    }
+    return true;
+}
+
+// one match played to the end the way the game plays it: no restarts, and each side stops once
+// is_match_over() (lingering on the socket for a second of game time after, like main does). Both
+// have to get there, on the same tick, with the state a plain re-run of their inputs ends in
+static bool test_netplay_to_goal()
+{
+    constexpr long long MAX_ITERATIONS = 120000;
+    constexpr double    LINGER_TIME    = 1.0;
+
+    RollbackSession sessions[2];
+    UdpSocket sockets[2];
+    std::vector<uint8_t> played[2];
+    CHECK(open_netplay_sockets(sockets));
+    for (int player = 0; player < 2; player++) sessions[player].start(player, PongSim(), false);
+
+    std::mt19937 random(11);
+    NetplayBot bots[2];
+    double end_times[2] = { -1.0, -1.0 };
+
+    double now = 0.0;
+    for (long long iteration = 0; iteration < MAX_ITERATIONS; iteration++)
+    {
+        bool is_finished = true;
+        for (int player = 0; player < 2; player++)
+        {
+            RollbackSession &session = sessions[player];
+            if (end_times[player] >= 0.0 && now >= end_times[player]) continue; // gone, nothing more from this side
+
+            uint8_t bits = bots[player].choose(session.get_state(), player, random);
+            if (session.advance(bits)) played[player].push_back(bits);
+            exchange_packets(session, sockets[player], now);
+
+            if (end_times[player] < 0.0 && session.is_match_over()) end_times[player] = now + LINGER_TIME;
+            is_finished = false;
+        }
+        if (is_finished) break;
+        now += FIXED_TIMESTEP;
+    }
+    CHECK(end_times[0] >= 0.0 && end_times[1] >= 0.0);
+    CHECK(now >= end_times[0] && now >= end_times[1]);
+
+    long long game_over_tick = sessions[0].get_game_over_tick();
+    printf("    the match ended on tick %lld, players quit at %.2f s and %.2f s\n", game_over_tick, end_times[0], end_times[1]);
+    CHECK(sessions[1].get_game_over_tick() == game_over_tick);
+
+    PongSim reference = PongSim();
+    for (long long tick = 0; tick < game_over_tick; tick++)
+    {
+        CHECK(!reference.is_game_over);
+        step(reference, netplay_inputs(played[0][tick], played[1][tick]), FIXED_TIMESTEP);
+    }
+    CHECK(reference.is_game_over);
+
+    for (int player = 0; player < 2; player++)
+    {
+        CHECK(sessions[player].get_tick() == game_over_tick);
+        CHECK(hash_state(sessions[player].get_state()) == hash_state(reference));
+    }
+    return true;
+}
+
+// ---- broadcasting to spectators ----
+
+// a single-player match with cat1 heading for where the ball will reach it, restarted whenever
+// it ends
+static void step_broadcast_match(PongSim &state)
+{
+    if (state.is_game_over)
+    {
+        state = PongSim();
+        state.is_single_player_mode = true;
+    }
+
+    float paddle = state.cat1_position.y + INIT_POS_CAT1.y,
+          target = predict_intercept_y(state.ball_position.x, state.ball_position.y,
+                                       state.ball_velocity.x, state.ball_velocity.y, CAT1_CONTACT_X);
+    PongInputs inputs;
+    inputs.cat1_up   = target > paddle + 0.25f;
+    inputs.cat1_down = target < paddle - 0.25f;
+    step(state, inputs, FIXED_TIMESTEP);
+}
+
+// the broadcast server and 100 viewers in one process on localhost: 6000 ticks run flat out
+// with a snapshot every other tick, a tenth of the viewers join halfway and another tenth
+// leave, and at the end every viewer still connected has to have decoded exactly the state the
+// server last sent
+static bool test_broadcast_loopback()
+{
+    constexpr int       VIEWER_COUNT        = 100;
+    constexpr long long TICK_COUNT          = 6000;
+    constexpr long long TICKS_PER_BROADCAST = 2;
+
+    BroadcastServer server;
+    CHECK(server.open(0));
+
+    // [0, late) join halfway, [late, 2 * late) leave then
+    std::vector<BroadcastViewer> viewers(VIEWER_COUNT);
+    int late = VIEWER_COUNT / 10;
+    for (int i = late; i < VIEWER_COUNT; i++) CHECK(viewers[i].connect("127.0.0.1", server.get_port()));
+
+    PongSim sim = PongSim();
+    sim.is_single_player_mode = true;
+
+    for (long long tick = 0; tick < TICK_COUNT; tick++)
+    {
+        if (tick == TICK_COUNT / 2)
+        {
+            for (int i = 0; i < late; i++) CHECK(viewers[i].connect("127.0.0.1", server.get_port()));
+            for (int i = late; i < 2 * late; i++) viewers[i].close();
+        }
+
+        step_broadcast_match(sim);
+        if (tick % TICKS_PER_BROADCAST == 0 || tick == TICK_COUNT - 1) server.broadcast(sim);
+
+        server.poll(0);
+        for (BroadcastViewer &viewer : viewers) viewer.receive();
+    }
+
+    // let the last frames drain, anyone behind is only waiting on the kernel
+    QuantizedSim final_state = quantize_sim(sim);
+    int staying = VIEWER_COUNT - late, caught_up = 0;
+    for (int attempt = 0; attempt < 1000 && caught_up < staying; attempt++)
+    {
+        server.poll(1);
+        caught_up = 0;
+        for (int i = 0; i < VIEWER_COUNT; i++)
+        {
+            if (i >= late && i < 2 * late) continue;
+
+            BroadcastViewer &viewer = viewers[i];
+            viewer.receive();
+            caught_up += viewer.is_connected() && viewer.has_state() &&
+                         memcmp(&viewer.get_state(), &final_state, sizeof(final_state)) == 0 ? 1 : 0;
+        }
+    }
+
+    const BroadcastServer::Stats &stats = server.get_stats();
+    printf("    %zu broadcasts to %zu viewers (%zu joined, %zu left), %zu snapshots sent, %zu key frames, %zu resyncs, "
+           "%.2f bytes each on the wire\n",
+           stats.frames, server.get_viewer_count(), stats.viewers_joined, stats.viewers_left, stats.frames_queued,
+           stats.key_frames, stats.resyncs, (double) stats.bytes_sent / stats.frames_queued);
+
+    CHECK(server.get_viewer_count() == (size_t) staying);
+    CHECK(caught_up == staying);
+    return true;
+}
+
+// ---- snapshots ----
+
+// a number exactly `width` bits wide, 1 to 32
+static uint32_t random_of_width(std::mt19937 &random, int width)
+{
+    uint32_t top = 1u << (width - 1);
+    return top | ((uint32_t) random() & (top - 1));
+}
+
+// a state whose delta from `baseline` is `delta` in `field` (zigzagged, or XOR'd for the flags)
+static void set_field_delta(QuantizedSim &state, const QuantizedSim &baseline, int field, uint32_t delta)
+{
+    if (field == FIELD_FLAGS) state.fields[field] = baseline.fields[field] ^ delta;
+    else                      state.fields[field] = baseline.fields[field] + ((delta >> 1) ^ (0u - (delta & 1)));
+}
+
+static bool same_fields(const QuantizedSim &a, const QuantizedSim &b)
+{
+    return memcmp(a.fields, b.fields, sizeof(a.fields)) == 0;
+}
+
+// what encode_snapshot() writes past SNAPSHOT_MAX_SIZE would show up here
+struct SnapshotBuffer
+{
+    static constexpr unsigned char GUARD = 0xCD;
+    unsigned char bytes[SNAPSHOT_MAX_SIZE + 16];
+
+    SnapshotBuffer() { memset(bytes, GUARD, sizeof(bytes)); }
+
+    bool is_guard_intact() const
+    {
+        for (size_t i = SNAPSHOT_MAX_SIZE; i < sizeof(bytes); i++) if (bytes[i] != GUARD) return false;
+        return true;
+    }
+};
+
+// random baselines with random fields changed, every field and every delta width from 1 to 32
+// bits getting a turn, as deltas and as key frames; then the states of a real match, which
+// have to survive dequantize_sim() and quantize_sim() too
+static bool test_snapshot_round_trip()
+{
+    constexpr int PAIRS_PER_WIDTH = 200;
+    printf("    %s codec\n", snapshot_codec_name());
+
+    std::mt19937 random(13);
+    size_t delta_bytes = 0, key_frame_bytes = 0, snapshots = 0;
+    for (int width = 1; width <= 32; width++)
+    {
+        for (int pair = 0; pair < PAIRS_PER_WIDTH; pair++)
+        {
+            QuantizedSim baseline, state;
+            for (int i = 0; i < SNAPSHOT_FIELD_COUNT; i++) baseline.fields[i] = (uint32_t) random();
+            state = baseline;
+
+            // this pair's width in one field, anything (or nothing) in the rest
+            for (int i = 0; i < SNAPSHOT_FIELD_COUNT; i++)
+            {
+                if (i == pair % SNAPSHOT_FIELD_COUNT) set_field_delta(state, baseline, i, random_of_width(random, width));
+                else if (random() % 2)                set_field_delta(state, baseline, i, random_of_width(random, 1 + (int) (random() % 32)));
+            }
+
+            SnapshotBuffer delta, key_frame;
+            size_t delta_size     = encode_snapshot(state, &baseline, delta.bytes),
+                   key_frame_size = encode_snapshot(state, nullptr, key_frame.bytes);
+            CHECK(delta_size <= SNAPSHOT_MAX_SIZE && delta.is_guard_intact());
+            CHECK(key_frame_size <= SNAPSHOT_MAX_SIZE && key_frame.is_guard_intact());
+            CHECK(is_delta_snapshot(delta.bytes, delta_size) && !is_delta_snapshot(key_frame.bytes, key_frame_size));
+
+            QuantizedSim decoded;
+            CHECK(decode_snapshot(delta.bytes, delta_size, &baseline, decoded) && same_fields(decoded, state));
+            CHECK(decode_snapshot(key_frame.bytes, key_frame_size, nullptr, decoded) && same_fields(decoded, state));
+            CHECK(decode_snapshot(key_frame.bytes, key_frame_size, &baseline, decoded) && same_fields(decoded, state));
+
+            delta_bytes     += delta_size;
+            key_frame_bytes += key_frame_size;
+            snapshots++;
+        }
+    }
+    printf("    %zu random pairs, %.1f bytes a delta and %.1f a key frame on average\n",
+           snapshots, (double) delta_bytes / snapshots, (double) key_frame_bytes / snapshots);
+
+    // a match, each tick sent against the one before, the way BroadcastServer does
+    PongSim sim = PongSim();
+    sim.is_single_player_mode = true;
+    QuantizedSim sent, received;
+    delta_bytes = 0;
+    for (int tick = 0; tick < 2000; tick++)
+    {
+        step_broadcast_match(sim);
+        QuantizedSim state = quantize_sim(sim);
+        CHECK(same_fields(quantize_sim(dequantize_sim(state)), state));
+
+        SnapshotBuffer buffer;
+        size_t size = encode_snapshot(state, tick > 0 ? &sent : nullptr, buffer.bytes);
+        CHECK(decode_snapshot(buffer.bytes, size, tick > 0 ? &received : nullptr, received) && same_fields(received, state));
+
+        sent = state;
+        delta_bytes += size;
+    }
+    printf("    a match: %.2f bytes a tick\n", delta_bytes / 2000.0);
+    return true;
+}
+
+// a snapshot that's cut short, from another version or a delta with no baseline has to be turned
+// down without touching the state it was going to be decoded into
+static bool test_snapshot_rejects()
+{
+    std::mt19937 random(17);
+
+    QuantizedSim baseline, state, untouched;
+    for (int i = 0; i < SNAPSHOT_FIELD_COUNT; i++)
+    {
+        baseline.fields[i]  = (uint32_t) random();
+        untouched.fields[i] = 0xAAAAAAAA;
+    }
+
+    // a small delta, a delta with every field at full width, and a key frame
+    QuantizedSim small = baseline, large = baseline;
+    set_field_delta(small, baseline, FIELD_BALL_X, 5);
+    for (int i = 0; i < SNAPSHOT_FIELD_COUNT; i++) set_field_delta(large, baseline, i, random_of_width(random, 32));
+
+    struct { const QuantizedSim *state, *baseline; } cases[] = { { &small, &baseline }, { &large, &baseline }, { &large, nullptr } };
+    for (const auto &test_case : cases)
+    {
+        SnapshotBuffer buffer;
+        size_t size = encode_snapshot(*test_case.state, test_case.baseline, buffer.bytes);
+
+        QuantizedSim decoded = untouched;
+        for (size_t truncated = 0; truncated < size; truncated++)
+        {
+            CHECK(!decode_snapshot(buffer.bytes, truncated, test_case.baseline, decoded));
+        }
+        CHECK(same_fields(decoded, untouched));
+
+        // any other version, this one's delta bit kept
+        unsigned char header = buffer.bytes[0];
+        for (int version = 0; version < 128; version++)
+        {
+            if (version == SNAPSHOT_VERSION) continue;
+            buffer.bytes[0] = (unsigned char) (version << 1 | (header & 1));
+            CHECK(!decode_snapshot(buffer.bytes, size, test_case.baseline, decoded));
+        }
+        buffer.bytes[0] = header;
+        CHECK(same_fields(decoded, untouched));
+
+        if (test_case.baseline != nullptr) CHECK(!decode_snapshot(buffer.bytes, size, nullptr, decoded));
+        CHECK(!decode_snapshot(buffer.bytes, SNAPSHOT_MAX_SIZE + 1, test_case.baseline, decoded));
+        CHECK(same_fields(decoded, untouched));
+
+        CHECK(decode_snapshot(buffer.bytes, size, test_case.baseline, decoded) && same_fields(decoded, *test_case.state));
+    }
+    return true;
+}
+
+// ---- input recordings ----
+
+// cat1 plays the ball, cat2's arrow keys go in a fixed pattern, and T hands cat2 to the AI partway
+// through and takes it back again later
+static PongInputs scripted_inputs(const PongSim &state, long long tick)
+{
+    float paddle = state.cat1_position.y + INIT_POS_CAT1.y,
+          target = predict_intercept_y(state.ball_position.x, state.ball_position.y,
+                                       state.ball_velocity.x, state.ball_velocity.y, CAT1_CONTACT_X);
+    PongInputs inputs;
+    inputs.cat1_up   = target > paddle + 0.25f;
+    inputs.cat1_down = target < paddle - 0.25f;
+    inputs.cat2_up   = tick / 90 % 3 == 0;
+    inputs.cat2_down = tick / 90 % 3 == 1;
+    inputs.toggle_single_player = tick == 600 || tick == 2400;
+    return inputs;
+}
+
+static std::vector<char> read_file(const std::filesystem::path &path)
+{
+    std::ifstream file(path, std::ios::binary);
+    return std::vector<char>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+static void write_file(const std::filesystem::path &path, const std::vector<char> &bytes, size_t size)
+{
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(bytes.data(), (std::streamsize) size);
+}
+
+// a match recorded the way update() records one, saved, loaded back and replayed (twice, with a
+// rewind) has to end in the state the recording says it did; and a recording cut short, from
+// another format version or another step size mustn't load
+static bool test_input_recording()
+{
+    constexpr long long MAX_TICKS = 6000;
+
+    PongSim sim = PongSim();
+    InputRecorder recorder;
+    bool was_single_player = false;
+    for (long long tick = 0; tick < MAX_TICKS && !sim.is_game_over; tick++)
+    {
+        PongInputs inputs = scripted_inputs(sim, tick);
+        recorder.record(inputs);
+        step(sim, inputs, FIXED_TIMESTEP);
+        was_single_player |= sim.is_single_player_mode;
+    }
+    printf("    recorded %lld ticks, the match %s\n", recorder.get_tick_count(), sim.is_game_over ? "ended" : "was still going");
+    CHECK(was_single_player && !sim.is_single_player_mode); // both toggles were played
+
+    std::filesystem::path path = std::filesystem::temp_directory_path() / "pong_tests_recording.rec";
+    CHECK(recorder.save(path.string().c_str(), sim));
+
+    InputReplay replay;
+    CHECK(replay.load(path.string().c_str()));
+    CHECK(replay.get_tick_count() == recorder.get_tick_count());
+    CHECK(replay.get_final_hash() == hash_state(sim));
+
+    for (int run = 0; run < 2; run++)
+    {
+        PongSim replayed = PongSim();
+        replay.rewind();
+        for (long long tick = 0; tick < replay.get_tick_count(); tick++) step(replayed, replay.next(), FIXED_TIMESTEP);
+        CHECK(hash_state(replayed) == replay.get_final_hash());
+    }
+
+    // the header is magic, version, step size, change count, tick count and hash; five bytes a change after it
+    constexpr size_t HEADER_SIZE = 32, VERSION_OFFSET = 4, TIMESTEP_OFFSET = 8;
+    std::vector<char> bytes = read_file(path);
+    CHECK(bytes.size() > HEADER_SIZE);
+
+    std::filesystem::path damaged_path = std::filesystem::temp_directory_path() / "pong_tests_damaged.rec";
+    for (size_t size : { (size_t) 0, HEADER_SIZE / 2, HEADER_SIZE - 1, HEADER_SIZE, bytes.size() - 5, bytes.size() - 1 })
+    {
+        write_file(damaged_path, bytes, size);
+        CHECK(!InputReplay().load(damaged_path.string().c_str()));
+    }
+
+    std::vector<char> other_version = bytes;
+    uint32_t version = InputRecorder::FORMAT_VERSION - 1;
+    memcpy(other_version.data() + VERSION_OFFSET, &version, sizeof(version));
+    write_file(damaged_path, other_version, other_version.size());
+    CHECK(!InputReplay().load(damaged_path.string().c_str()));
+
+    std::vector<char> other_step = bytes;
+    float timestep = FIXED_TIMESTEP / 2.0f;
+    memcpy(other_step.data() + TIMESTEP_OFFSET, &timestep, sizeof(timestep));
+    write_file(damaged_path, other_step, other_step.size());
+    CHECK(!InputReplay().load(damaged_path.string().c_str()));
+
+    // the untouched copy still loads, so it was the damage that got the others turned down
+    write_file(damaged_path, bytes, bytes.size());
+    CHECK(InputReplay().load(damaged_path.string().c_str()));
+
+    std::filesystem::remove(path);
+    std::filesystem::remove(damaged_path);
+    return true;
+}
+
+// ---- running them ----
+
+struct Test
+{
+    const char *name;
+    bool (*run)();
+};
+
+static const Test TESTS[] =
+{
+    { "vecenv_no_allocations", test_vecenv_no_allocations },
+    { "vecenv_serves",         test_vecenv_serves },
+    { "swept_no_tunnelling",   test_swept_no_tunnelling },
+    { "sweep_ball_edges",      test_sweep_ball_edges },
+    { "collision_kernel",      test_collision_kernel },
+    { "netplay_loopback",      test_netplay_loopback },
+    { "netplay_to_goal",       test_netplay_to_goal },
+    { "broadcast_loopback",    test_broadcast_loopback },
+    { "snapshot_round_trip",   test_snapshot_round_trip },
+    { "snapshot_rejects",      test_snapshot_rejects },
+    { "input_recording",       test_input_recording },
+};
+
+int main(int argc, char **argv)
+{
+    if (argc == 2 && strcmp(argv[1], "--list") == 0)
+    {
+        for (const Test &test : TESTS) printf("%s\n", test.name);
+        return 0;
+    }
+
+    int failures = 0, runs = 0;
+    for (const Test &test : TESTS)
+    {
+        bool is_selected = argc == 1;
+        for (int i = 1; i < argc; i++) is_selected |= strcmp(argv[i], test.name) == 0;
+        if (!is_selected) continue;
+
+        printf("%s\n", test.name);
+        bool passed = test.run();
+        printf("%s %s\n", passed ? "passed" : "FAILED", test.name);
+        failures += passed ? 0 : 1;
+        runs++;
+    }
+
+    if (runs == 0)
+    {
+        printf("No tests matched, see --list\n");
+        return 1;
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,80 @@
+#include "VecEnv.h"
+
+VecEnv::VecEnv(size_t env_count, const VecEnvSettings &settings)
+    : m_settings(settings), m_batch(env_count), m_inputs(env_count), m_episode_ticks(env_count, 0)
+{
+    m_initial_state.is_single_player_mode = settings.is_cat2_ai;
+
+    if (settings.thread_count > 1) m_pool = std::make_unique<WorkStealingPool>(settings.thread_count);
+    m_step_range = [this](size_t begin, size_t end) { step_range(begin, end); };
+}
+
+void VecEnv::observe(size_t index, float *observation) const
+{
+    float speed = m_batch.ball_speed[index];
+    observation[BALL_X]          = m_batch.ball_x[index];
+    observation[BALL_Y]          = m_batch.ball_y[index];
+    observation[BALL_VELOCITY_X] = m_batch.velocity_x[index] * speed;
+    observation[BALL_VELOCITY_Y] = m_batch.velocity_y[index] * speed;
+    observation[CAT1_Y]          = m_batch.cat1_y[index] + INIT_POS_CAT1.y;
+    observation[CAT2_Y]          = m_batch.cat2_y[index] + INIT_POS_CAT2.y;
+}
+
+void VecEnv::reset(float *observations)
+{
+    for (size_t i = 0; i < size(); i++)
+    {
+        m_batch.load(i, m_initial_state);
+        m_episode_ticks[i] = 0;
+        observe(i, observations + i * OBSERVATION_SIZE);
+    }
+}
+
+void VecEnv::step(const int8_t *actions, float *observations, float *rewards, uint8_t *dones)
+{
+    m_actions      = actions;
+    m_observations = observations;
+    m_rewards      = rewards;
+    m_dones        = dones;
+
+    if (m_pool) {
+        m_pool->parallel_for(size(), m_settings.chunk_size, m_step_range);
+    } else {
+        step_range(0, size());
+    }
+}
+
+void VecEnv::step_range(size_t begin, size_t end)
+{
+    for (size_t i = begin; i < end; i++)
+    {
+        const int8_t *action = m_actions + i * ACTIONS_PER_ENV;
+        PongInputs &inputs = m_inputs[i];
+        inputs.cat1_up   = action[0] > 0;
+        inputs.cat1_down = action[0] < 0;
+        inputs.cat2_up   = action[1] > 0;
+        inputs.cat2_down = action[1] < 0;
+    }
+
+    m_batch.step_range(begin, end, m_inputs.data(), FIXED_TIMESTEP, m_settings.ai);
+
+    for (size_t i = begin; i < end; i++)
+    {
+        float   reward = 0.0f;
+        uint8_t done   = m_batch.is_game_over[i];
+
+        // the ball leaving on the right is cat2's miss
+        if (done) reward = m_batch.ball_x[i] > 0.0f ? 1.0f : -1.0f;
+        if (++m_episode_ticks[i] == m_settings.max_episode_ticks) done = 1;
+
+        if (done)
+        {
+            m_batch.load(i, m_initial_state);
+            m_episode_ticks[i] = 0;
+        }
+
+        m_rewards[i] = reward;
+        m_dones[i]   = done;
+        observe(i, m_observations + i * OBSERVATION_SIZE);
+    }
+}